@@ -20,34 +20,60 @@
  * THE SOFTWARE.
  */
 
-#include <atomic>
 #include <cstddef>
-#include <cstdio>
+#include <cstdint>
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <string>
 #include <string_view>
-#include <thread>
+
+extern "C" {
+/**
+ * @brief The host services table of the v2 ABI, only ever extended at the end.
+ */
+struct refvalue_svchostify_host_v2 {
+    std::uint32_t size;
+    std::uint32_t version;
+    void* context;
+    void (*log)(void* context, std::int32_t level, const char* message, std::size_t size);
+    std::int32_t (*stop_requested)(void* context);
+    std::int32_t (*wait_for_stop)(void* context, std::uint32_t timeout);
+    void (*heartbeat)(void* context);
+    void (*add_counter)(void* context, const char* name, std::int64_t delta);
+    void (*notify_ready)(void* context);
+    std::size_t (*get_listen_sockets)(void* context, std::uintptr_t* sockets, std::size_t capacity);
+};
+}
 
 namespace {
+    constexpr std::int32_t log_level_info = 2;
+
     class test_service {
     public:
-        test_service() : running_{false} {}
+        test_service() : host_{} {}
+
+        /**
+         * @brief Stores the host services table, called before the 'run' routine.
+         * @param host The host services table which stays valid until the DLL is unloaded.
+         */
+        void init(const refvalue_svchostify_host_v2* host) noexcept {
+            host_ = host;
+        }
 
         /**
          * @brief The service entry point.
          * @param argc The count of the arguments.
          * @param argv The input arguments.
          */
-        void run(std::size_t argc, const char* argv[]) {
-            using std::chrono_literals::operator""ms;
-
-            std::cout << "A Svchost run from Cplusplus.\n";
-            std::cout << "All outputs to stdout will be redirected to the logging file that you configured.\n";
-            std::cout << "Input arguments:\n";
+        void run(std::size_t argc, const char* argv[]) const {
+            log("A Svchost run from Cplusplus.");
+            log("Logs sent through the host table are written to the service logger directly.");
+            std::cout << "All outputs to stdout will still be redirected to the logging file that you configured.\n";
+            log("Input arguments:");
 
             for (std::size_t i = 0; i < argc; i++) {
-                std::cout << argv[i] << '\n';
+                log(argv[i]);
             }
 
             static constexpr std::string_view file_name{"output_cplusplus.txt"};
@@ -58,40 +84,43 @@ namespace {
                 stream.write(text.data(), text.size());
             }
 
-            running_.store(true, std::memory_order::release);
+            host_->notify_ready(host_->context);
 
-            for (std::size_t i = 0; running_.load(std::memory_order::acquire); i++) {
-                std::cout << "Hello service counter: " << i << '\n';
-                std::this_thread::sleep_for(100ms);
+            // Waits on the stop token of the host, so that no 'on_stop' routine is needed.
+            for (std::size_t i = 0; host_->wait_for_stop(host_->context, 100) == 0; i++) {
+                log("Hello service counter: " + std::to_string(i));
+                host_->heartbeat(host_->context);
+                host_->add_counter(host_->context, "iterations", 1);
             }
-        }
 
-        /**
-         * This function will be called by the SvcHostify routine in another thread and,
-         * you can, for example, send a signal to your 'run' routine to stop gracefully.
-         */
-        void on_stop() {
-            printf("A stop signal received.\n");
-            printf("Requesting a stop.\n");
-
-            running_.store(false, std::memory_order::release);
+            log("A stop signal received.");
         }
 
     private:
-        std::atomic_bool running_;
+        void log(std::string_view message) const {
+            host_->log(host_->context, log_level_info, message.data(), message.size());
+        }
+
+        const refvalue_svchostify_host_v2* host_;
     };
 
     test_service service;
 } // namespace
 
 extern "C" {
+__declspec(dllexport) std::int32_t refvalue_svchostify_init_v2(const refvalue_svchostify_host_v2* host) {
+    if (host->version < 2) {
+        return 1;
+    }
+
+    service.init(host);
+
+    return 0;
+}
+
 __declspec(dllexport) void refvalue_svchostify_run(std::size_t argc, const char* argv[]) try {
     service.run(argc, argv);
 } catch (std::exception& ex) {
     std::cout << ex.what() << '\n';
 }
-
-__declspec(dllexport) void refvalue_svchostify_on_stop() try { service.on_stop(); } catch (std::exception& ex) {
-    std::cout << ex.what() << '\n';
-}
 }
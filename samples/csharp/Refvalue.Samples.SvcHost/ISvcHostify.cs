@@ -22,4 +22,38 @@ namespace Refvalue.Samples.SvcHost
         /// </summary>
         void OnStop();
     }
+
+    /// <summary>
+    /// Implemented by SvcHostify and handed to the service through ISvcHostifyHostAware.
+    /// </summary>
+    [ComVisible(true)]
+    [Guid("5A7C2E14-8B3D-4F6A-9C21-D4E8F0B13A67")]
+    [InterfaceType(ComInterfaceType.InterfaceIsIUnknown)]
+    public interface ISvcHostifyHost
+    {
+        /// <summary>
+        /// Tells the host that the service is alive.
+        /// </summary>
+        void Heartbeat();
+
+        /// <summary>
+        /// Tells the host that the service is able to serve.
+        /// </summary>
+        void NotifyReady();
+    }
+
+    /// <summary>
+    /// Optionally implemented by the service to receive the host before 'Run' is called.
+    /// </summary>
+    [ComVisible(true)]
+    [Guid("9E3B6D51-2F84-4C7A-B0D9-71A5C3E8F426")]
+    [InterfaceType(ComInterfaceType.InterfaceIsIUnknown)]
+    public interface ISvcHostifyHostAware
+    {
+        /// <summary>
+        /// Attaches the host to the service.
+        /// </summary>
+        /// <param name="host">The host</param>
+        void Attach(ISvcHostifyHost host);
+    }
 }
@@ -6,9 +6,19 @@ namespace Refvalue.Samples.SvcHost
     [ComVisible(true)]
     [Guid("47D7093F-69E2-D17D-422D-49BE836EF3A5")]
     [ClassInterface(ClassInterfaceType.None)]
-    public class TestService : ISvcHostify
+    public class TestService : ISvcHostify, ISvcHostifyHostAware
     {
         private int _running = 0;
+        private ISvcHostifyHost? _host;
+
+        /// <summary>
+        /// Attaches the host to the service.
+        /// </summary>
+        /// <param name="host">The host</param>
+        public void Attach(ISvcHostifyHost host)
+        {
+            _host = host;
+        }
 
         /// <summary>
         /// The service entry point.
@@ -34,10 +44,12 @@ namespace Refvalue.Samples.SvcHost
             }
 
             Interlocked.Exchange(ref _running, 1);
+            _host?.NotifyReady();
 
             for (int i = 0; Interlocked.CompareExchange(ref _running, 1, 1) == 1; i++)
             {
                 Console.WriteLine($"Hello service counter: {i}");
+                _host?.Heartbeat();
                 Thread.Sleep(100);
             }
 
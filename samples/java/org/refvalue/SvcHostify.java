@@ -19,6 +19,16 @@ public final class SvcHostify {
         }
     }
 
+    /**
+     * Tells the host that the service is alive, bound by SvcHostify if declared.
+     */
+    public static native void heartbeat();
+
+    /**
+     * Tells the host that the service is able to serve, bound by SvcHostify if declared.
+     */
+    public static native void notifyReady();
+
     /**
      * The main routine of the service.
      * 
@@ -43,10 +53,12 @@ public final class SvcHostify {
         }
 
         running.setRelease(true);
+        notifyReady();
 
         // The main loop of your service.
         for (int i = 0; running.getAcquire(); i++) {
             System.out.println(String.format("Hello service counter: %d", i));
+            heartbeat();
 
             try {
                 Thread.sleep(100);
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2024 The RefValue Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+export module refvalue.svchostify:abstract.service_status_backend;
+import std;
+
+export namespace essence::win {
+    enum class service_state {
+        unknown,
+        stopped,
+        start_pending,
+        stop_pending,
+        running,
+        continue_pending,
+        pause_pending,
+        paused,
+    };
+
+    struct service_status_record {
+        std::string name;
+        std::string display_name;
+        service_state state{service_state::unknown};
+        std::uint32_t process_id{};
+    };
+} // namespace essence::win
+
+export namespace essence::win::abstract {
+    // Supplies the raw data of the fleet status query so that the SCM and the registry can be substituted.
+    class service_status_backend {
+    public:
+        template <typename T>
+            requires(!std::same_as<std::decay_t<T>, service_status_backend>)
+        explicit service_status_backend(T&& value)
+            : wrapper_{std::make_shared<wrapper<std::decay_t<T>>>(std::forward<T>(value))} {}
+
+        [[nodiscard]] std::vector<service_status_record> enumerate_services() const {
+            return wrapper_->enumerate_services();
+        }
+
+        [[nodiscard]] std::optional<std::string> get_startup_configuration(std::string_view service_name) const {
+            return wrapper_->get_startup_configuration(service_name);
+        }
+
+        [[nodiscard]] std::optional<std::uint32_t> get_restart_count(std::string_view service_name) const {
+            return wrapper_->get_restart_count(service_name);
+        }
+
+        [[nodiscard]] std::optional<std::chrono::seconds> get_service_uptime(std::string_view service_name) const {
+            return wrapper_->get_service_uptime(service_name);
+        }
+
+    private:
+        struct base {
+            virtual ~base()                                                                               = default;
+            virtual std::vector<service_status_record> enumerate_services()                               = 0;
+            virtual std::optional<std::string> get_startup_configuration(std::string_view service_name)   = 0;
+            virtual std::optional<std::uint32_t> get_restart_count(std::string_view service_name)         = 0;
+            virtual std::optional<std::chrono::seconds> get_service_uptime(std::string_view service_name) = 0;
+        };
+
+        template <typename T>
+        class wrapper final : public base {
+        public:
+            template <std::convertible_to<T> U>
+            explicit wrapper(U&& value) : value_{std::forward<U>(value)} {}
+
+            std::vector<service_status_record> enumerate_services() override {
+                return value_.enumerate_services();
+            }
+
+            std::optional<std::string> get_startup_configuration(std::string_view service_name) override {
+                return value_.get_startup_configuration(service_name);
+            }
+
+            std::optional<std::uint32_t> get_restart_count(std::string_view service_name) override {
+                return value_.get_restart_count(service_name);
+            }
+
+            std::optional<std::chrono::seconds> get_service_uptime(std::string_view service_name) override {
+                return value_.get_service_uptime(service_name);
+            }
+
+        private:
+            T value_;
+        };
+
+        std::shared_ptr<base> wrapper_;
+    };
+} // namespace essence::win::abstract
@@ -22,6 +22,7 @@
 
 module refvalue.svchostify:abstract.service_worker;
 import :service_config;
+import :worker_context;
 import std;
 
 namespace essence::win::abstract {
@@ -35,6 +36,14 @@ namespace essence::win::abstract {
             return wrapper_->config();
         }
 
+        void attach(const std::shared_ptr<worker_context>& context) const {
+            wrapper_->attach(context);
+        }
+
+        void prepare() const {
+            wrapper_->prepare();
+        }
+
         void on_start() const {
             wrapper_->on_start();
         }
@@ -49,11 +58,13 @@ namespace essence::win::abstract {
 
     private:
         struct base {
-            virtual ~base()                        = default;
-            virtual const service_config& config() = 0;
-            virtual void on_start()                = 0;
-            virtual void on_stop()                 = 0;
-            virtual void run()                     = 0;
+            virtual ~base()                                                     = default;
+            virtual const service_config& config()                              = 0;
+            virtual void attach(const std::shared_ptr<worker_context>& context) = 0;
+            virtual void prepare()                                              = 0;
+            virtual void on_start()                                             = 0;
+            virtual void on_stop()                                              = 0;
+            virtual void run()                                                  = 0;
         };
 
         template <typename T>
@@ -66,6 +77,20 @@ namespace essence::win::abstract {
                 return value_.config();
             }
 
+            // The channel to the host is optional, so a worker not supporting it is left alone.
+            void attach(const std::shared_ptr<worker_context>& context) override {
+                if constexpr (requires { value_.attach(context); }) {
+                    value_.attach(context);
+                }
+            }
+
+            // Brings a standby to an idle but fully initialized state, a worker without it is ready once attached.
+            void prepare() override {
+                if constexpr (requires { value_.prepare(); }) {
+                    value_.prepare();
+                }
+            }
+
             void on_start() override {
                 value_.on_start();
             }
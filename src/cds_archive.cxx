@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2024 The RefValue Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+module;
+
+#include <essence/char8_t_remediation.hpp>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NOGDI
+
+#include <Windows.h>
+
+module refvalue.svchostify:cds_archive;
+import :jvm_options;
+import :service_config;
+import :util;
+import essence.basic;
+import essence.crypto;
+import std;
+
+namespace essence::win {
+    // A class file of a directory on the class path has its root, while a JAR has none.
+    struct class_path_entry {
+        std::filesystem::path root;
+        std::filesystem::path file;
+    };
+
+    // The archive is dumped in a separate JVM, which loads every class of the class path.
+    constexpr DWORD cds_dump_timeout = 10 * 60 * 1000;
+
+    template <std::integral T>
+    T read_little_endian(std::span<const char> buffer, std::size_t offset) {
+        T result{};
+
+        if (offset + sizeof(T) > buffer.size()) {
+            throw formatted_runtime_error{U8("The central directory of the JAR is truncated.")};
+        }
+
+        std::memcpy(&result, buffer.data() + offset, sizeof(T));
+
+        return result;
+    }
+
+    // Lists the classes of a JAR from its central directory, found through the record ending the file. ZIP64 archives
+    // are not supported.
+    std::vector<std::string> list_jar_classes(const std::filesystem::path& path) {
+        static constexpr std::uint32_t end_signature   = 0x06054B50;
+        static constexpr std::uint32_t entry_signature = 0x02014B50;
+        static constexpr std::size_t end_record_size   = 22;
+        static constexpr std::size_t entry_header_size = 46;
+        static constexpr std::size_t max_comment_size  = 0xFFFF;
+        static constexpr std::string_view class_suffix{U8(".class")};
+
+        std::ifstream stream{path, std::ios::binary};
+        const auto file_size = std::filesystem::file_size(path);
+        const auto tail_size =
+            static_cast<std::size_t>(std::min<std::uintmax_t>(file_size, end_record_size + max_comment_size));
+        std::vector<char> tail(tail_size);
+
+        stream.seekg(static_cast<std::streamoff>(file_size - tail_size));
+        stream.read(tail.data(), static_cast<std::streamsize>(tail.size()));
+
+        std::optional<std::size_t> end_offset;
+
+        for (auto i = tail.size() >= end_record_size ? tail.size() - end_record_size + 1 : 0; i-- > 0;) {
+            if (read_little_endian<std::uint32_t>(tail, i) == end_signature) {
+                end_offset = i;
+                break;
+            }
+        }
+
+        if (!end_offset) {
+            throw formatted_runtime_error{
+                U8("JAR Path"), from_u8string(path.generic_u8string()), U8("Message"), U8("The JAR is malformed.")};
+        }
+
+        const auto entry_count      = read_little_endian<std::uint16_t>(tail, *end_offset + 10);
+        const auto directory_size   = read_little_endian<std::uint32_t>(tail, *end_offset + 12);
+        const auto directory_offset = read_little_endian<std::uint32_t>(tail, *end_offset + 16);
+        std::vector<char> directory(directory_size);
+        std::vector<std::string> result;
+
+        stream.seekg(static_cast<std::streamoff>(directory_offset));
+
+        if (!stream.read(directory.data(), static_cast<std::streamsize>(directory.size()))) {
+            throw formatted_runtime_error{U8("JAR Path"), from_u8string(path.generic_u8string()), U8("Message"),
+                U8("Failed to read the central directory of the JAR.")};
+        }
+
+        for (std::size_t i = 0, offset = 0; i < entry_count; i++) {
+            if (read_little_endian<std::uint32_t>(directory, offset) != entry_signature) {
+                throw formatted_runtime_error{U8("JAR Path"), from_u8string(path.generic_u8string()), U8("Message"),
+                    U8("The central directory of the JAR is malformed.")};
+            }
+
+            const auto name_size    = read_little_endian<std::uint16_t>(directory, offset + 28);
+            const auto extra_size   = read_little_endian<std::uint16_t>(directory, offset + 30);
+            const auto comment_size = read_little_endian<std::uint16_t>(directory, offset + 32);
+
+            if (offset + entry_header_size + name_size > directory.size()) {
+                throw formatted_runtime_error{U8("The central directory of the JAR is truncated.")};
+            }
+
+            // Versioned and module descriptors are left to the JVM.
+            if (const std::string_view name{directory.data() + offset + entry_header_size, name_size};
+                name.ends_with(class_suffix) && !name.starts_with(U8("META-INF/"))
+                && !name.ends_with(U8("module-info.class"))) {
+                result.emplace_back(name.substr(0, name.size() - class_suffix.size()));
+            }
+
+            offset += entry_header_size + name_size + extra_size + comment_size;
+        }
+
+        return result;
+    }
+
+    std::vector<class_path_entry> scan_class_path(std::string_view class_path) {
+        std::vector<class_path_entry> result;
+
+        for (auto&& path : expand_class_path(class_path)) {
+            if (std::filesystem::is_directory(path)) {
+                for (auto&& file : std::filesystem::recursive_directory_iterator{path}) {
+                    if (file.is_regular_file() && file.path().extension() == u8".class") {
+                        result.emplace_back(class_path_entry{.root = path, .file = file.path()});
+                    }
+                }
+            } else if (std::filesystem::is_regular_file(path)) {
+                result.emplace_back(class_path_entry{.file = path});
+            }
+        }
+
+        return result;
+    }
+
+    // The archive is only valid for the same JDK, options and classes, so any change of them invalidates it.
+    std::string make_cds_stamp(const service_config& config, std::span<const class_path_entry> entries) {
+        std::string text{*config.jdk_directory};
+
+        for (auto&& item : make_jvm_options(config)) {
+            text.append(U8("\n")).append(item);
+        }
+
+        for (auto&& item : entries) {
+            text.append(format(U8("\n{}|{}|{}"), from_u8string(item.file.generic_u8string()),
+                std::filesystem::file_size(item.file),
+                std::filesystem::last_write_time(item.file).time_since_epoch().count()));
+        }
+
+        // Persisted across runs, so the digest must not depend on the toolchain like std::hash.
+        return crypto::make_digest(crypto::digest_mode::sha3_224, text);
+    }
+
+    std::size_t write_class_list(const std::filesystem::path& path, std::span<const class_path_entry> entries) {
+        std::ofstream stream{path, std::ios::trunc};
+        std::size_t count{};
+
+        for (auto&& item : entries) {
+            if (item.root.empty()) {
+                for (auto&& name : list_jar_classes(item.file)) {
+                    stream << name << U8('\n');
+                    ++count;
+                }
+            } else {
+                auto relative = item.file.lexically_relative(item.root);
+
+                stream << from_u8string(relative.replace_extension().generic_u8string()) << U8('\n');
+                ++count;
+            }
+        }
+
+        if (!stream.flush()) {
+            throw formatted_runtime_error{U8("Class List"), from_u8string(path.generic_u8string()), U8("Message"),
+                U8("Failed to write the class list.")};
+        }
+
+        return count;
+    }
+
+    void dump_cds_archive(const service_config& config, const std::filesystem::path& archive,
+        const std::filesystem::path& class_list) {
+        using kernel_handle = unique_handle<&CloseHandle>;
+
+        const auto java_path = std::filesystem::path{to_u8string(*config.jdk_directory)} / u8"bin" / u8"java.exe";
+        std::vector<std::string> args{
+            from_u8string(java_path.generic_u8string()),
+            U8("-Xshare:dump"),
+            format(U8("-XX:SharedClassListFile={}"), from_u8string(class_list.generic_u8string())),
+            format(U8("-XX:SharedArchiveFile={}"), from_u8string(archive.generic_u8string())),
+        };
+
+        std::ranges::move(make_jvm_options(config), std::back_inserter(args));
+
+        auto command_line = make_command_line(args);
+        STARTUPINFOW si{.cb = sizeof(STARTUPINFOW)};
+        PROCESS_INFORMATION pi{};
+
+        if (!CreateProcessW(java_path.c_str(), command_line.data(), nullptr, nullptr, FALSE, CREATE_NO_WINDOW, nullptr,
+                nullptr, &si, &pi)) {
+            throw formatted_runtime_error{U8("Java Path"), from_u8string(java_path.generic_u8string()), U8("Message"),
+                U8("Failed to start the JVM dumping the CDS archive."), U8("Internal"), get_last_error()};
+        }
+
+        const kernel_handle thread{pi.hThread};
+        const kernel_handle process{pi.hProcess};
+
+        if (WaitForSingleObject(process.get(), cds_dump_timeout) != WAIT_OBJECT_0) {
+            TerminateProcess(process.get(), ERROR_TIMEOUT);
+
+            throw formatted_runtime_error{U8("The JVM dumping the CDS archive timed out.")};
+        }
+
+        if (DWORD exit_code{}; !GetExitCodeProcess(process.get(), &exit_code) || exit_code != 0) {
+            throw formatted_runtime_error{
+                U8("Exit Code"), exit_code, U8("Message"), U8("The JVM failed to dump the CDS archive.")};
+        }
+    }
+
+    // Returns the option to map the archive, which is generated first for a new or changed class path. The archive
+    // only speeds up the start, so a failure falls back to a regular start.
+    std::optional<std::string> prepare_cds_archive(const service_config& config) {
+        if (!config.jvm || !config.jvm->cds.value_or(service_config::defaults().jvm.cds)) {
+            return std::nullopt;
+        }
+
+        try {
+            // Stored next to the logs, which are known to be writable.
+            const auto logger_config = config.logger.value_or(service_config::defaults().logger.to_config());
+            const auto directory =
+                std::filesystem::absolute(std::filesystem::path{to_u8string(logger_config.base_path)}.parent_path());
+            const auto archive    = directory / to_u8string(format(U8("{}.jsa"), config.name));
+            const auto stamp_path = std::filesystem::path{archive}.concat(u8".stamp");
+            const auto class_list = std::filesystem::path{archive}.concat(u8".classlist");
+            const auto entries    = scan_class_path(config.context);
+            const auto stamp      = make_cds_stamp(config, entries);
+            auto option = format(U8("-XX:SharedArchiveFile={}"), from_u8string(archive.generic_u8string()));
+
+            if (std::string current; std::filesystem::exists(archive)
+                                     && std::getline(std::ifstream{stamp_path}, current) && current == stamp) {
+                spdlog::info(U8("Using the CDS archive {}."), from_u8string(archive.generic_u8string()));
+
+                return option;
+            }
+
+            const auto started_at = std::chrono::steady_clock::now();
+
+            std::filesystem::create_directories(directory);
+            std::filesystem::remove(archive);
+            std::filesystem::remove(stamp_path);
+
+            const auto count = write_class_list(class_list, entries);
+
+            dump_cds_archive(config, archive, class_list);
+            std::ofstream{stamp_path, std::ios::trunc} << stamp << U8('\n');
+            spdlog::info(U8("The CDS archive {} has been generated with {} classes in {} ms."),
+                from_u8string(archive.generic_u8string()), count,
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started_at)
+                    .count());
+
+            return option;
+        } catch (const std::exception& ex) {
+            spdlog::warn(U8("The CDS archive is not used: {}"), ex.what());
+
+            return std::nullopt;
+        }
+    }
+} // namespace essence::win
@@ -29,6 +29,57 @@ export namespace essence::win {
         pure_c,
         com,
         jvm,
+        python,
+        dotnet,
+    };
+
+    enum class restart_policy {
+        never,
+        on_failure,
+        always,
+    };
+
+    enum class stop_escalation {
+        terminate_process,
+        abandon,
+    };
+
+    enum class stop_signal {
+        ctrl_break,
+        close_window,
+        quit_message,
+        terminate,
+    };
+
+    enum class readiness_probe {
+        notify,
+        port,
+    };
+
+    enum class priority_level {
+        idle,
+        below_normal,
+        normal,
+        above_normal,
+        high,
+    };
+
+    enum class io_priority_level {
+        very_low,
+        normal,
+    };
+
+    enum class numa_memory_policy {
+        local,
+        interleave,
+    };
+
+    enum class jvm_gc {
+        serial,
+        parallel,
+        g1,
+        z,
+        shenandoah,
     };
 
     enum class service_account_type {
@@ -25,7 +25,10 @@ module;
 #include <essence/char8_t_remediation.hpp>
 
 module refvalue.svchostify;
+import :cron_schedule;
 import :file_size_unit;
+import :jvm_options;
+import :resource_limits;
 import essence.basic;
 import essence.io;
 import essence.serialization;
@@ -37,6 +40,9 @@ namespace essence::win {
         constexpr std::pair valid_file_size_range{1024ULL, 1024 * 1024 * 1024 * 2ULL};
         constexpr std::pair valid_file_count_range{1ULL, 32ULL};
 
+        // Below it, a loop waiting for the worker would spin rather than wait.
+        constexpr std::uint32_t min_wait_interval{100U};
+
         class stdio_to_sink_dispatcher {
             struct formatter : spdlog::formatter {
                 void format(const spdlog::details::log_msg& msg, spdlog::memory_buf_t& dest) override {
@@ -77,9 +83,7 @@ namespace essence::win {
 
         std::atomic<std::shared_ptr<stdio_to_sink_dispatcher>> dispatcher;
 
-        auto parse_logger_config(const service_config& config) {
-            const auto logger_config = config.logger.value_or(service_config::defaults().logger.to_config());
-
+        auto parse_logger_config(const service_config::logger_config& logger_config) {
             if (logger_config.base_path.empty()) {
                 throw formatted_runtime_error{U8("The logger base path must be non-empty.")};
             }
@@ -130,8 +134,25 @@ namespace essence::win {
             return context{logger_config.base_path, *max_size, max_files};
         }
 
+        // A member of a host group without a logger configuration gets a log file named after it, next to the default
+        // log file, instead of sharing the latter with the other members.
+        service_config::logger_config get_member_logger_config(const service_config& config) {
+            if (config.logger) {
+                return *config.logger;
+            }
+
+            auto result = service_config::defaults().logger.to_config();
+
+            result.base_path = from_u8string((std::filesystem::path{to_u8string(result.base_path)}.parent_path()
+                                                 / to_u8string(format(U8("{}.log"), config.name)))
+                                                 .generic_u8string());
+
+            return result;
+        }
+
         void setup_logger(const service_config& config, bool enable_file_logging) {
-            const auto logger_config = parse_logger_config(config);
+            const auto logger_config =
+                parse_logger_config(config.logger.value_or(service_config::defaults().logger.to_config()));
 
             if (enable_file_logging) {
                 auto instance = std::make_shared<stdio_to_sink_dispatcher>();
@@ -151,6 +172,130 @@ namespace essence::win {
             spdlog::default_logger()->flush_on(spdlog::level::info);
             spdlog::info(U8("Logger configuration: {}"), json(logger_config).dump(4));
         }
+
+        void validate_stop_config(const service_config::stop_config& stop) {
+            const auto& defaults           = service_config::defaults().stop;
+            const auto checkpoint_interval = stop.checkpoint_interval.value_or(defaults.checkpoint_interval);
+            const auto grace_period        = stop.grace_period.value_or(defaults.grace_period);
+
+            if (checkpoint_interval < min_wait_interval) {
+                throw formatted_runtime_error{U8("Checkpoint Interval"), checkpoint_interval, U8("Lower Bound"),
+                    min_wait_interval, U8("Message"), U8("The checkpoint interval was out of range.")};
+            }
+
+            if (grace_period < min_wait_interval) {
+                throw formatted_runtime_error{U8("Grace Period"), grace_period, U8("Lower Bound"), min_wait_interval,
+                    U8("Message"), U8("The grace period was out of range.")};
+            }
+        }
+
+        void validate_readiness_config(const service_config::readiness_config& readiness) {
+            const auto& defaults      = service_config::defaults().readiness;
+            const auto timeout        = readiness.timeout.value_or(defaults.timeout);
+            const auto probe_interval = readiness.probe_interval.value_or(defaults.probe_interval);
+
+            if (readiness.probe == readiness_probe::port && !readiness.port) {
+                throw formatted_runtime_error{U8("The port must be set for the readiness probe.")};
+            }
+
+            if (timeout < min_wait_interval) {
+                throw formatted_runtime_error{U8("Readiness Timeout"), timeout, U8("Lower Bound"), min_wait_interval,
+                    U8("Message"), U8("The readiness timeout was out of range.")};
+            }
+
+            if (probe_interval < min_wait_interval) {
+                throw formatted_runtime_error{U8("Probe Interval"), probe_interval, U8("Lower Bound"),
+                    min_wait_interval, U8("Message"), U8("The probe interval was out of range.")};
+            }
+        }
+
+        // The standby is only kept for a supervised service which is not scheduled.
+        void validate_supervisor_config(const service_config& config) {
+            const auto& defaults  = service_config::defaults().supervisor;
+            const auto supervisor = config.supervisor.value_or(service_config::supervisor_config{});
+
+            if (config.schedule || supervisor.policy.value_or(defaults.policy) == restart_policy::never
+                || !supervisor.warm_standby.value_or(defaults.warm_standby)) {
+                return;
+            }
+
+            if (config.worker_type != service_worker_type::pure_c
+                && config.worker_type != service_worker_type::executable) {
+                throw formatted_runtime_error{U8("A warm standby requires a pure_c or executable worker.")};
+            }
+
+            if (config.replicas && config.replicas->listen_port) {
+                throw formatted_runtime_error{U8("A warm standby cannot share the listening port of the replicas.")};
+            }
+        }
+
+        void validate_schedule_config(const service_config::schedule_config& schedule) {
+            if (schedule.interval.has_value() == schedule.cron.has_value() || schedule.interval == 0U) {
+                throw formatted_runtime_error{
+                    U8("Either a positive interval or a cron expression must be set for the schedule.")};
+            }
+
+            // A valid expression may still never match, such as one for February 30th.
+            if (schedule.cron) {
+                static_cast<void>(
+                    cron_schedule{*schedule.cron}.next(std::chrono::system_clock::now(), *std::chrono::current_zone()));
+            }
+        }
+
+        // Fails early rather than upon the start of the worker.
+        // The settings of the one JVM of a process, which the first jvm service started creates. The class path is
+        // left out, as an isolated worker loads its classes by itself.
+        auto get_jvm_settings(const service_config& config) {
+            return std::tuple{config.jdk_directory, get_jni_version(config),
+                make_jvm_options(config) | std::views::drop(1) | std::ranges::to<std::vector>()};
+        }
+
+        void validate_config(const service_config& config) {
+            if (config.resources) {
+                get_memory_limit(*config.resources);
+            }
+
+            if (config.stop) {
+                validate_stop_config(*config.stop);
+            }
+
+            // A shorter deadline would be missed before the first beat.
+            if (config.heartbeat && config.heartbeat->deadline < min_wait_interval) {
+                throw formatted_runtime_error{U8("Heartbeat Deadline"), config.heartbeat->deadline, U8("Lower Bound"),
+                    min_wait_interval, U8("Message"), U8("The heartbeat deadline was out of range.")};
+            }
+
+            if (config.readiness) {
+                validate_readiness_config(*config.readiness);
+            }
+
+            if (config.supervisor) {
+                validate_supervisor_config(config);
+            }
+
+            if (config.schedule) {
+                validate_schedule_config(*config.schedule);
+
+                if (config.activation) {
+                    throw formatted_runtime_error{U8("A scheduled service cannot be socket-activated.")};
+                }
+            }
+
+            if (config.activation && config.worker_type != service_worker_type::pure_c
+                && config.worker_type != service_worker_type::executable) {
+                throw formatted_runtime_error{U8("Socket activation requires a pure_c or executable worker.")};
+            }
+
+            if (config.worker_type == service_worker_type::jvm) {
+                get_jni_version(config);
+                get_channel_capacity(config);
+                make_jvm_options(config);
+            }
+
+            if (config.worker_type == service_worker_type::dotnet && (!config.dotnet || !config.dotnet->type)) {
+                throw formatted_runtime_error{U8("The type of the .NET worker must be set.")};
+            }
+        }
     } // namespace
 
     void setup_config(const service_config& config, bool enable_file_logging) {
@@ -166,12 +311,97 @@ namespace essence::win {
         setup_logger(config, enable_file_logging);
         spdlog::info(json(config).dump(4));
 
+        validate_config(config);
+
         auto dll_directories = config.dll_directories.value_or(std::vector<std::string>{});
 
         std::ranges::copy(service_config::defaults().dll_directories, std::back_inserter(dll_directories));
         add_dll_directories(dll_directories);
     }
 
+    void setup_group_config(std::string_view group_name, std::span<const service_config> configs) {
+        if (configs.empty()) {
+            throw formatted_runtime_error{
+                U8("Host Group"), group_name, U8("Message"), U8("The host group does not contain any service.")};
+        }
+
+        // The members share the working directory of the first one, and the captured stdio goes to a group log file
+        // next to its log files.
+        auto group_config  = configs.front();
+        auto logger_config = group_config.logger.value_or(service_config::defaults().logger.to_config());
+
+        logger_config.base_path = from_u8string(
+            (std::filesystem::path{to_u8string(logger_config.base_path)}.parent_path()
+                / to_u8string(format(U8("{}.log"), group_name)))
+                .generic_u8string());
+
+        group_config.logger = std::move(logger_config);
+        setup_config(group_config, true);
+
+        const auto working_directory =
+            group_config.working_directory.value_or(service_config::defaults().working_directory);
+        const auto normalize_log_path = [](std::string_view path) {
+            return std::filesystem::absolute(to_u8string(path)).lexically_normal();
+        };
+
+        std::set<std::string_view> names;
+        std::set<std::filesystem::path> log_paths{normalize_log_path(group_config.logger->base_path)};
+        std::optional<decltype(get_jvm_settings(group_config))> jvm_settings;
+        std::optional<std::optional<std::string>> dotnet_root;
+
+        // Any member failing to start would leave the group half running, so all of them must be valid.
+        for (auto&& item : configs) {
+            try {
+                if (!names.emplace(item.name).second) {
+                    throw formatted_runtime_error{U8("The service is listed more than once in the host group.")};
+                }
+
+                if (const auto item_directory =
+                        item.working_directory.value_or(service_config::defaults().working_directory);
+                    item_directory != working_directory) {
+                    throw formatted_runtime_error{U8("Working Directory"), item_directory, U8("Message"),
+                        U8("The members of a host group must share the same working directory.")};
+                }
+
+                // Two loggers rotating the same file would overwrite each other.
+                if (const auto log_path = get_member_logger_config(item).base_path;
+                    !log_paths.emplace(normalize_log_path(log_path)).second) {
+                    throw formatted_runtime_error{U8("Log File"), log_path, U8("Message"),
+                        U8("The log file is already used by another member of the host group.")};
+                }
+
+                validate_config(item);
+
+                // The JVM settings of a later member would be silently ignored.
+                if (item.worker_type == service_worker_type::jvm) {
+                    if (auto settings = get_jvm_settings(item); !jvm_settings) {
+                        jvm_settings = std::move(settings);
+                    } else if (settings != *jvm_settings) {
+                        throw formatted_runtime_error{U8("The jvm members of a host group must share the JDK and the "
+                                                         "JVM settings, as there is only one JVM in a process.")};
+                    }
+                }
+
+                // Likewise, the first dotnet member started decides the .NET installation.
+                if (item.worker_type == service_worker_type::dotnet) {
+                    if (const auto root = item.dotnet->root; !dotnet_root) {
+                        dotnet_root = root;
+                    } else if (root != *dotnet_root) {
+                        throw formatted_runtime_error{U8("The dotnet members of a host group must share the .NET "
+                                                         "root, as there is only one .NET runtime in a process.")};
+                    }
+                }
+            } catch (const std::exception&) {
+                aggregate_error::throw_nested(formatted_runtime_error{U8("Host Group"), group_name, U8("Service"),
+                    item.name, U8("Message"), U8("Invalid configuration of a host group member.")});
+            }
+        }
+
+        for (auto&& item : configs | std::views::drop(1)) {
+            add_dll_directories(item.dll_directories.value_or(std::vector<std::string>{}));
+        }
+    }
+
     service_config load_config_and_setup(std::string_view path, bool enable_file_logging) {
         auto config = [&] {
             try {
@@ -187,6 +417,21 @@ namespace essence::win {
         return config;
     }
 
+    std::shared_ptr<spdlog::logger> make_service_logger(const service_config& config, bool dedicated_file) {
+        if (!dedicated_file) {
+            return spdlog::default_logger()->clone(config.name);
+        }
+
+        const auto logger_config = parse_logger_config(get_member_logger_config(config));
+        auto logger              = std::make_shared<spdlog::logger>(config.name,
+            std::make_shared<spdlog::sinks::rotating_file_sink_mt>(
+                logger_config.base_path, logger_config.max_size, logger_config.max_files));
+
+        logger->flush_on(spdlog::level::info);
+
+        return logger;
+    }
+
     std::shared_ptr<void> get_logger_shutdown_token() {
         return {&dispatcher, [](auto) {
                     spdlog::default_logger()->flush();
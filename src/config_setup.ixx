@@ -1,9 +1,12 @@
 export module refvalue.svchostify:config_setup;
 import :service_config;
+import essence.basic;
 import std;
 
 export namespace essence::win {
     void setup_config(const service_config& config, bool enable_file_logging = false);
+    void setup_group_config(std::string_view group_name, std::span<const service_config> configs);
     service_config load_config_and_setup(std::string_view path, bool enable_file_logging = false);
+    std::shared_ptr<spdlog::logger> make_service_logger(const service_config& config, bool dedicated_file = false);
     std::shared_ptr<void> get_logger_shutdown_token();
 } // namespace essence::win
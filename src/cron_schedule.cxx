@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2024 The RefValue Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+module;
+
+#include <essence/char8_t_remediation.hpp>
+
+module refvalue.svchostify:cron_schedule;
+import essence.basic;
+import std;
+
+namespace essence::win {
+    // A five-field cron expression: minute, hour, day of month, month and day of week. Each field accepts '*', values,
+    // ranges, lists and steps. The time is passed in, so that the schedule does not depend on the clock.
+    class cron_schedule {
+    public:
+        explicit cron_schedule(std::string_view expression) {
+            std::vector<std::string_view> fields;
+
+            for (auto&& item : expression | std::views::split(U8(' '))) {
+                if (!item.empty()) {
+                    fields.emplace_back(item.begin(), item.end());
+                }
+            }
+
+            if (fields.size() != 5) {
+                throw formatted_runtime_error{U8("Cron Expression"), expression, U8("Message"),
+                    U8("The cron expression must have five fields.")};
+            }
+
+            minutes_  = parse_field(fields[0], 0, 59);
+            hours_    = parse_field(fields[1], 0, 23);
+            days_     = parse_field(fields[2], 1, 31);
+            months_   = parse_field(fields[3], 1, 12);
+            weekdays_ = parse_field(fields[4], 0, 7);
+
+            // Sunday is both 0 and 7.
+            if (weekdays_.test(7)) {
+                weekdays_.set(0);
+            }
+
+            // Like the classic cron, a day matches either field if both are restricted.
+            any_day_     = fields[2].starts_with(U8('*'));
+            any_weekday_ = fields[4].starts_with(U8('*'));
+        }
+
+        // Returns the first matching minute strictly after the given time, in the local time of the zone.
+        [[nodiscard]] std::chrono::system_clock::time_point next(
+            std::chrono::system_clock::time_point after, const std::chrono::time_zone& zone) const {
+            auto local       = std::chrono::floor<std::chrono::minutes>(zone.to_local(after)) + std::chrono::minutes{1};
+            const auto limit = local + std::chrono::years{5};
+
+            while (local < limit) {
+                const auto day = std::chrono::floor<std::chrono::days>(local);
+                const std::chrono::year_month_day date{day};
+                const std::chrono::hh_mm_ss time{local - day};
+
+                if (!months_.test(static_cast<unsigned>(date.month()))) {
+                    local = std::chrono::local_days{date.year() / date.month() / 1 + std::chrono::months{1}};
+                } else if (!match_day(date, std::chrono::weekday{day})) {
+                    local = day + std::chrono::days{1};
+                } else if (!hours_.test(static_cast<std::size_t>(time.hours().count()))) {
+                    local = day + time.hours() + std::chrono::hours{1};
+                } else if (!minutes_.test(static_cast<std::size_t>(time.minutes().count()))) {
+                    local += std::chrono::minutes{1};
+                } else {
+                    // A time skipped by the daylight saving is moved to the transition.
+                    return zone.to_sys(local, std::chrono::choose::earliest);
+                }
+            }
+
+            throw formatted_runtime_error{U8("The cron expression never matches.")};
+        }
+
+    private:
+        using field = std::bitset<64>;
+
+        [[nodiscard]] bool match_day(std::chrono::year_month_day date, std::chrono::weekday weekday) const {
+            const auto day_matched     = days_.test(static_cast<unsigned>(date.day()));
+            const auto weekday_matched = weekdays_.test(weekday.c_encoding());
+
+            return !any_day_ && !any_weekday_ ? day_matched || weekday_matched : day_matched && weekday_matched;
+        }
+
+        static field parse_field(std::string_view text, std::uint32_t lower, std::uint32_t upper) {
+            field result;
+
+            for (auto&& item : text | std::views::split(U8(','))) {
+                const std::string_view part{item.begin(), item.end()};
+                const auto slash = part.find(U8('/'));
+                const auto range = part.substr(0, slash);
+                const auto step  = slash == std::string_view::npos ? 1U : parse_number(text, part.substr(slash + 1));
+                std::uint32_t first{lower};
+                std::uint32_t last{upper};
+
+                if (range != U8("*")) {
+                    if (const auto dash = range.find(U8('-')); dash != std::string_view::npos) {
+                        first = parse_number(text, range.substr(0, dash));
+                        last  = parse_number(text, range.substr(dash + 1));
+                    } else {
+                        first = parse_number(text, range);
+                        last  = slash == std::string_view::npos ? first : upper;
+                    }
+                }
+
+                if (step == 0 || first < lower || last > upper || first > last) {
+                    throw formatted_runtime_error{U8("Cron Field"), text, U8("Lower Bound"), lower,
+                        U8("Upper Bound"), upper, U8("Message"), U8("The cron field was out of range.")};
+                }
+
+                for (auto i = first; i <= last; i += step) {
+                    result.set(i);
+                }
+            }
+
+            return result;
+        }
+
+        static std::uint32_t parse_number(std::string_view field, std::string_view text) {
+            std::uint32_t result{};
+
+            if (const auto [ptr, code] = std::from_chars(text.data(), text.data() + text.size(), result);
+                code != std::errc{} || ptr != text.data() + text.size() || text.empty()) {
+                throw formatted_runtime_error{
+                    U8("Cron Field"), field, U8("Message"), U8("The cron field must consist of numbers.")};
+            }
+
+            return result;
+        }
+
+        field minutes_;
+        field hours_;
+        field days_;
+        field months_;
+        field weekdays_;
+        bool any_day_{};
+        bool any_weekday_{};
+    };
+} // namespace essence::win
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2024 The RefValue Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+module;
+
+#include <essence/char8_t_remediation.hpp>
+
+module refvalue.svchostify:jvm_options;
+import :common_types;
+import :file_size_unit;
+import :service_config;
+import essence.basic;
+import std;
+
+namespace essence::win {
+    // The values of JNI_VERSION_1_x and JNI_VERSION_x, without depending on the JNI headers. Only the versions defined
+    // by a JDK are accepted, as JNI_CreateJavaVM rejects the others.
+    std::int32_t get_jni_version(const service_config& config) {
+        constexpr std::array legacy_versions{1, 2, 4, 6, 8};
+        constexpr std::array versions{9, 10, 19, 20, 21, 24};
+
+        const auto version =
+            config.jvm ? config.jvm->jni_version.value_or(service_config::defaults().jvm.jni_version)
+                       : service_config::defaults().jvm.jni_version;
+        const auto legacy = version.starts_with(U8("1."));
+        const auto number = from_string<std::int32_t>(legacy ? version.substr(2) : version);
+
+        if (legacy && number && std::ranges::contains(legacy_versions, *number)) {
+            return 0x00010000 | *number;
+        }
+
+        if (!legacy && number && std::ranges::contains(versions, *number)) {
+            return *number << 16;
+        }
+
+        throw formatted_runtime_error{U8("JNI Version"), version, U8("Message"),
+            U8("The JNI version must be one of 1.1, 1.2, 1.4, 1.6, 1.8, 9, 10, 19, 20, 21 and 24.")};
+    }
+
+    // The capacity of each ring of the channel to the Java code, rounded up to a power of two.
+    std::size_t get_channel_capacity(const service_config& config) {
+        constexpr std::uint64_t min_capacity = 4096;
+        constexpr std::uint64_t max_capacity = 64 * 1024 * 1024;
+
+        const auto size =
+            config.jvm ? config.jvm->channel_size.value_or(service_config::defaults().jvm.channel_size)
+                       : service_config::defaults().jvm.channel_size;
+
+        if (const auto bytes = parse_file_size(size); bytes && *bytes >= min_capacity && *bytes <= max_capacity) {
+            return static_cast<std::size_t>(std::bit_ceil(*bytes));
+        }
+
+        throw formatted_runtime_error{
+            U8("Channel Size"), size, U8("Message"), U8("The channel size must be between 4 KiB and 64 MiB.")};
+    }
+
+    // Entries are separated by semicolons, and an entry ending with '*' stands for all JARs of the directory.
+    std::vector<std::filesystem::path> expand_class_path(std::string_view class_path) {
+        std::vector<std::filesystem::path> result;
+
+        for (auto&& item : class_path | std::views::split(U8(';'))) {
+            const std::string_view entry{item.begin(), item.end()};
+
+            if (entry.empty()) {
+                continue;
+            }
+
+            if (!entry.ends_with(U8('*'))) {
+                result.emplace_back(to_u8string(entry));
+                continue;
+            }
+
+            for (auto&& file : std::filesystem::directory_iterator{to_u8string(entry.substr(0, entry.size() - 1))}) {
+                if (file.is_regular_file() && file.path().extension() == u8".jar") {
+                    result.emplace_back(file.path());
+                }
+            }
+        }
+
+        return result;
+    }
+
+    std::string_view get_gc_option(jvm_gc gc) noexcept {
+        switch (gc) {
+        case jvm_gc::serial:
+            return U8("-XX:+UseSerialGC");
+        case jvm_gc::parallel:
+            return U8("-XX:+UseParallelGC");
+        case jvm_gc::z:
+            return U8("-XX:+UseZGC");
+        case jvm_gc::shenandoah:
+            return U8("-XX:+UseShenandoahGC");
+        default:
+            return U8("-XX:+UseG1GC");
+        }
+    }
+
+    // Makes the options passed to JNI_CreateJavaVM, the arbitrary options coming last to override the others.
+    std::vector<std::string> make_jvm_options(const service_config& config) {
+        const auto jvm = config.jvm.value_or(service_config::jvm_config{});
+        std::vector<std::string> result{format(U8("-Djava.class.path={}"), config.context)};
+
+        const auto add_heap_size = [&](std::string_view prefix, const std::optional<std::string>& size) {
+            if (!size) {
+                return std::optional<std::uint64_t>{};
+            }
+
+            const auto bytes = parse_file_size(*size);
+
+            if (!bytes || *bytes == 0) {
+                throw formatted_runtime_error{
+                    U8("Heap Size"), *size, U8("Message"), U8("Invalid heap size of the JVM.")};
+            }
+
+            result.emplace_back(format(U8("{}{}"), prefix, *bytes));
+
+            return bytes;
+        };
+
+        const auto heap_min = add_heap_size(U8("-Xms"), jvm.heap_min);
+        const auto heap_max = add_heap_size(U8("-Xmx"), jvm.heap_max);
+
+        if (heap_min && heap_max && *heap_min > *heap_max) {
+            throw formatted_runtime_error{U8("Min Heap Size"), *jvm.heap_min, U8("Max Heap Size"), *jvm.heap_max,
+                U8("Message"), U8("The min heap size must not exceed the max heap size.")};
+        }
+
+        if (jvm.gc) {
+            result.emplace_back(get_gc_option(*jvm.gc));
+        }
+
+        for (auto&& [key, value] : jvm.properties.value_or(std::map<std::string, std::string>{})) {
+            if (key.empty() || key.contains(U8('='))) {
+                throw formatted_runtime_error{
+                    U8("System Property"), key, U8("Message"), U8("The name of a system property is invalid.")};
+            }
+
+            result.emplace_back(format(U8("-D{}={}"), key, value));
+        }
+
+        for (auto&& item : jvm.options.value_or(std::vector<std::string>{})) {
+            if (!item.starts_with(U8('-'))) {
+                throw formatted_runtime_error{
+                    U8("JVM Option"), item, U8("Message"), U8("A JVM option must start with '-'.")};
+            }
+
+            result.emplace_back(item);
+        }
+
+        return result;
+    }
+} // namespace essence::win
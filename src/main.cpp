@@ -34,6 +34,7 @@
 
 import essence.basic;
 import essence.cli;
+import essence.serialization;
 import refvalue.svchostify;
 import std;
 
@@ -88,6 +89,12 @@ void WINAPI invokeW(HWND window, HINSTANCE instance, const wchar_t* command_line
                              .add_aliases(U8("u"))
                              .as_abstract();
 
+    auto opt_status = option<bool>{}
+                          .set_bound_name(U8("status"))
+                          .set_description(U8("Prints the status of all services managed by this host as JSON."))
+                          .add_aliases(U8("s"))
+                          .as_abstract();
+
     auto opt_config_file = option<std::string>{}
                                .set_bound_name(U8("config_file"))
                                .set_description(U8("Sets the configuration file path."))
@@ -105,6 +112,7 @@ void WINAPI invokeW(HWND window, HINSTANCE instance, const wchar_t* command_line
 
     parser.add_option(std::move(opt_install));
     parser.add_option(std::move(opt_uninstall));
+    parser.add_option(std::move(opt_status));
     parser.add_option(std::move(opt_config_file));
 
     parser.on_output([](std::string_view message) {
@@ -119,6 +127,15 @@ void WINAPI invokeW(HWND window, HINSTANCE instance, const wchar_t* command_line
     }
 
     if (const auto info = parser.to_model<startup_info>()) {
+        if (info->status) {
+            const auto payload = json(query_service_statuses()).dump(4);
+
+            std::fwrite(payload.data(), sizeof(char), payload.size(), stdout);
+            std::fputc(U8('\n'), stdout);
+
+            return;
+        }
+
         const auto make_config = [&] { return load_config_and_setup(info->config_file); };
 
         if (info->install) {
@@ -154,8 +171,11 @@ ES_API(SVCHOSTIFY) void WINAPI ServiceMain(DWORD argc, wchar_t** argv) {
 
         const auto service_name = argv[0];
 
+        auto config = load_service_config_from_registry(service_name);
+
+        setup_config(config, true);
         service_process::instance().init(service_name);
-        service_process::instance().run(make_service_worker_from_registry(service_name));
+        service_process::instance().run(std::move(config));
     } catch (const std::exception& ex) {
         spdlog::error(ex.what());
         OutputDebugStringW(to_native_string(ex.what()).c_str());
@@ -170,4 +190,25 @@ void WINAPI serviceW(HWND window, HINSTANCE instance, const wchar_t* command_lin
     OutputDebugStringW(command_line);
     ServiceMain(1, new (&storage) wchar_t* {const_cast<wchar_t*>(command_line)});
 }
+
+ES_API(SVCHOSTIFY)
+void WINAPI serviceGroupW(HWND window, HINSTANCE instance, const wchar_t* command_line, std::int32_t show) {
+    const auto token = get_logger_shutdown_token();
+
+    static_cast<void>(token);
+
+    try {
+        if (get_session_id() != 0) {
+            throw formatted_runtime_error{U8("The program can only be running in service mode.")};
+        }
+
+        auto configs = load_host_group_from_registry(command_line);
+
+        setup_group_config(to_utf8_string(command_line), configs);
+        service_process::instance().run_group(std::move(configs));
+    } catch (const std::exception& ex) {
+        spdlog::error(ex.what());
+        OutputDebugStringW(to_native_string(ex.what()).c_str());
+    }
+}
 }
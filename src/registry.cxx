@@ -29,6 +29,7 @@ module;
 #include <essence/char8_t_remediation.hpp>
 
 #include <Windows.h>
+#include <sddl.h>
 #include <shellapi.h>
 
 module refvalue.svchostify:registry;
@@ -111,14 +112,20 @@ namespace essence::win {
 
         template <typename Container>
             requires std::is_standard_layout_v<typename Container::value_type>
-        Container get_registry(std::string_view path, std::string_view name, std::uint32_t flags) {
+        std::optional<Container> query_registry(std::string_view path, std::string_view name, std::uint32_t flags) {
             auto&& [key, sub_key] = decompose_registry_path(path);
             const auto wide_name  = to_native_string(name);
 
             DWORD size{};
 
-            check_registry_error(RegGetValueW(key, sub_key.c_str(), wide_name.c_str(), flags, nullptr, nullptr, &size),
-                U8("Key"), path, U8("Name"), name, U8("Message"),
+            const auto code = RegGetValueW(key, sub_key.c_str(), wide_name.c_str(), flags, nullptr, nullptr, &size);
+
+            // A missing key or value is reported as an empty result rather than an error.
+            if (code == ERROR_FILE_NOT_FOUND) {
+                return std::nullopt;
+            }
+
+            check_registry_error(code, U8("Key"), path, U8("Name"), name, U8("Message"),
                 U8("Failed to get the storage size of the registry value."));
 
             Container result;
@@ -132,6 +139,29 @@ namespace essence::win {
 
             return result;
         }
+
+        template <typename Container>
+            requires std::is_standard_layout_v<typename Container::value_type>
+        Container get_registry(std::string_view path, std::string_view name, std::uint32_t flags) {
+            if (auto result = query_registry<Container>(path, name, flags)) {
+                return *std::move(result);
+            }
+
+            check_registry_error(ERROR_FILE_NOT_FOUND, U8("Key"), path, U8("Name"), name, U8("Message"),
+                U8("The registry value does not exist."));
+
+            std::unreachable();
+        }
+
+        std::vector<abi::string> split_multi_string(std::wstring_view buffer) {
+            auto lines = buffer | std::views::take(buffer.size() - 1) | std::views::split(L'\0')
+                       | std::views::transform([](const auto& inner) {
+                             return to_utf8_string(std::wstring_view{inner.begin(), inner.end()});
+                         })
+                       | std::ranges::to<std::vector>();
+
+            return lines;
+        }
     } // namespace
 
     abi::string get_registry_string(std::string_view path, std::string_view name) {
@@ -140,14 +170,25 @@ namespace essence::win {
             get_registry<std::wstring>(path, name, RRF_RT_REG_SZ).c_str()); // NOLINT(*-redundant-string-cstr)
     }
 
+    std::optional<abi::string> try_get_registry_string(std::string_view path, std::string_view name) {
+        if (const auto result = query_registry<std::wstring>(path, name, RRF_RT_REG_SZ)) {
+            return to_utf8_string(result->c_str()); // NOLINT(*-redundant-string-cstr)
+        }
+
+        return std::nullopt;
+    }
+
     std::vector<abi::string> get_registry_multi_string(std::string_view path, std::string_view name) {
-        const auto buffer = get_registry<std::wstring>(path, name, RRF_RT_REG_MULTI_SZ);
-        auto lines        = buffer | std::views::take(buffer.size() - 1) | std::views::split(L'\0')
-                   | std::views::transform(
-                       [](const auto& inner) { return to_utf8_string(std::wstring_view{inner.begin(), inner.end()}); })
-                   | std::ranges::to<std::vector>();
+        return split_multi_string(get_registry<std::wstring>(path, name, RRF_RT_REG_MULTI_SZ));
+    }
 
-        return lines;
+    std::optional<std::vector<abi::string>> try_get_registry_multi_string(
+        std::string_view path, std::string_view name) {
+        if (const auto result = query_registry<std::wstring>(path, name, RRF_RT_REG_MULTI_SZ)) {
+            return split_multi_string(*result);
+        }
+
+        return std::nullopt;
     }
 
     std::vector<std::byte> get_registry_binary(std::string_view path, std::string_view name) {
@@ -158,10 +199,26 @@ namespace essence::win {
         return get_registry<registry_integer_adapter<std::uint32_t>>(path, name, RRF_RT_REG_DWORD).value;
     }
 
+    std::optional<std::uint32_t> try_get_registry_dword(std::string_view path, std::string_view name) {
+        if (const auto result = query_registry<registry_integer_adapter<std::uint32_t>>(path, name, RRF_RT_REG_DWORD)) {
+            return result->value;
+        }
+
+        return std::nullopt;
+    }
+
     std::uint64_t get_registry_qword(std::string_view path, std::string_view name) {
         return get_registry<registry_integer_adapter<std::uint64_t>>(path, name, RRF_RT_REG_QWORD).value;
     }
 
+    std::optional<std::uint64_t> try_get_registry_qword(std::string_view path, std::string_view name) {
+        if (const auto result = query_registry<registry_integer_adapter<std::uint64_t>>(path, name, RRF_RT_REG_QWORD)) {
+            return result->value;
+        }
+
+        return std::nullopt;
+    }
+
     void set_registry(std::string_view path, std::string_view name, std::span<const std::string> values) {
         auto multi_sz = join_with(values | std::views::transform(&to_native_string), std::array{L'\0'})
                       | std::ranges::to<std::wstring>();
@@ -189,6 +246,34 @@ namespace essence::win {
         set_registry(path, name, REG_QWORD, &value, sizeof(value));
     }
 
+    void create_registry_key(std::string_view path, zstring_view security_descriptor) {
+        auto&& [key, sub_key] = decompose_registry_path(path);
+        PSECURITY_DESCRIPTOR descriptor{};
+
+        if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(
+                to_native_string(security_descriptor).c_str(), SDDL_REVISION_1, &descriptor, nullptr)) {
+            throw formatted_runtime_error{U8("Security Descriptor"), security_descriptor, U8("Message"),
+                U8("Failed to parse the security descriptor."), U8("Internal"), get_last_error()};
+        }
+
+        const scope_exit descriptor_scope{[&] { LocalFree(descriptor); }};
+        SECURITY_ATTRIBUTES attributes{.nLength = sizeof(SECURITY_ATTRIBUTES), .lpSecurityDescriptor = descriptor};
+        HKEY handle{};
+        DWORD disposition{};
+
+        check_registry_error(RegCreateKeyExW(key, sub_key.c_str(), 0, nullptr, REG_OPTION_NON_VOLATILE, WRITE_DAC,
+                                 &attributes, &handle, &disposition),
+            U8("Key"), path, U8("Message"), U8("Failed to create the registry key."));
+
+        const scope_exit key_scope{[&] { RegCloseKey(handle); }};
+
+        // An existing key is given the same security as a new one.
+        if (disposition == REG_OPENED_EXISTING_KEY) {
+            check_registry_error(RegSetKeySecurity(handle, DACL_SECURITY_INFORMATION, descriptor), U8("Key"), path,
+                U8("Message"), U8("Failed to set the security of the registry key."));
+        }
+    }
+
     void delete_registry(std::string_view path) {
         auto&& [key, sub_key] = decompose_registry_path(path);
 
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2024 The RefValue Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+module;
+
+#include <essence/char8_t_remediation.hpp>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NOGDI
+
+#include <Windows.h>
+
+module refvalue.svchostify:resource_limits;
+import :common_types;
+import :file_size_unit;
+import :service_config;
+import essence.basic;
+import std;
+
+namespace essence::win {
+    std::optional<std::uint64_t> get_memory_limit(const service_config::resource_config& resources) {
+        if (!resources.memory_limit) {
+            return std::nullopt;
+        }
+
+        if (const auto size = parse_file_size(*resources.memory_limit); size && *size != 0) {
+            return size;
+        }
+
+        throw formatted_runtime_error{
+            U8("Memory Limit"), *resources.memory_limit, U8("Message"), U8("Invalid memory limit of the resources.")};
+    }
+
+    [[nodiscard]] bool has_affinity(const service_config::resource_config& resources) noexcept {
+        return resources.affinity || resources.numa_node;
+    }
+
+    // Masks are relative to the processor group of the host, so a node of another group cannot be used.
+    DWORD_PTR get_numa_node_mask(std::uint16_t node) {
+        GROUP_AFFINITY node_affinity{};
+        GROUP_AFFINITY thread_affinity{};
+
+        if (!GetNumaNodeProcessorMaskEx(node, &node_affinity) || node_affinity.Mask == 0) {
+            throw formatted_runtime_error{U8("NUMA Node"), node, U8("Message"), U8("The NUMA node does not exist."),
+                U8("Internal"), get_last_error()};
+        }
+
+        if (!GetThreadGroupAffinity(GetCurrentThread(), &thread_affinity)
+            || thread_affinity.Group != node_affinity.Group) {
+            throw formatted_runtime_error{U8("NUMA Node"), node, U8("Processor Group"), node_affinity.Group,
+                U8("Message"), U8("The NUMA node is outside the processor group of the host.")};
+        }
+
+        return node_affinity.Mask;
+    }
+
+    // Only the processors available to the host, and those of the NUMA node if any, can be used.
+    DWORD_PTR get_effective_affinity(const service_config::resource_config& resources) {
+        DWORD_PTR process_mask{};
+        DWORD_PTR system_mask{};
+
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+            throw formatted_runtime_error{
+                U8("Message"), U8("Failed to get the process affinity."), U8("Internal"), get_last_error()};
+        }
+
+        auto result = process_mask & static_cast<DWORD_PTR>(resources.affinity.value_or(~std::uint64_t{}));
+
+        if (resources.numa_node) {
+            result &= get_numa_node_mask(*resources.numa_node);
+        }
+
+        if (result != 0) {
+            return result;
+        }
+
+        throw formatted_runtime_error{U8("Affinity"), resources.affinity.value_or(~std::uint64_t{}),
+            U8("NUMA Node"), resources.numa_node.value_or(0), U8("Process Affinity"), process_mask, U8("Message"),
+            U8("The affinity does not contain any processor available to the host.")};
+    }
+
+    DWORD get_priority_class(priority_level priority) noexcept {
+        switch (priority) {
+        case priority_level::idle:
+            return IDLE_PRIORITY_CLASS;
+        case priority_level::below_normal:
+            return BELOW_NORMAL_PRIORITY_CLASS;
+        case priority_level::above_normal:
+            return ABOVE_NORMAL_PRIORITY_CLASS;
+        case priority_level::high:
+            return HIGH_PRIORITY_CLASS;
+        default:
+            return NORMAL_PRIORITY_CLASS;
+        }
+    }
+
+    int get_thread_priority(priority_level priority) noexcept {
+        switch (priority) {
+        case priority_level::idle:
+            return THREAD_PRIORITY_LOWEST;
+        case priority_level::below_normal:
+            return THREAD_PRIORITY_BELOW_NORMAL;
+        case priority_level::above_normal:
+            return THREAD_PRIORITY_ABOVE_NORMAL;
+        case priority_level::high:
+            return THREAD_PRIORITY_HIGHEST;
+        default:
+            return THREAD_PRIORITY_NORMAL;
+        }
+    }
+
+    // Adds the limits to those already set on the job, which covers all processes assigned to it. There is no I/O
+    // priority limit for jobs, so it is left to the caller.
+    void apply_job_limits(HANDLE job, const service_config::resource_config& resources) {
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION info{};
+
+        if (!QueryInformationJobObject(job, JobObjectExtendedLimitInformation, &info, sizeof(info), nullptr)) {
+            throw formatted_runtime_error{
+                U8("Message"), U8("Failed to query the limits of the job object."), U8("Internal"), get_last_error()};
+        }
+
+        if (has_affinity(resources)) {
+            info.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_AFFINITY;
+            info.BasicLimitInformation.Affinity = get_effective_affinity(resources);
+        }
+
+        if (resources.priority) {
+            info.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_PRIORITY_CLASS;
+            info.BasicLimitInformation.PriorityClass = get_priority_class(*resources.priority);
+        }
+
+        if (const auto memory_limit = get_memory_limit(resources)) {
+            info.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_JOB_MEMORY;
+            info.JobMemoryLimit = static_cast<SIZE_T>(*memory_limit);
+        }
+
+        if (!SetInformationJobObject(job, JobObjectExtendedLimitInformation, &info, sizeof(info))) {
+            throw formatted_runtime_error{
+                U8("Message"), U8("Failed to set the limits of the job object."), U8("Internal"), get_last_error()};
+        }
+    }
+
+    std::string describe_job_limits(HANDLE job) {
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION info{};
+
+        if (!QueryInformationJobObject(job, JobObjectExtendedLimitInformation, &info, sizeof(info), nullptr)) {
+            return U8("unknown");
+        }
+
+        const auto flags = info.BasicLimitInformation.LimitFlags;
+
+        return std::format(U8("affinity: {}, priority class: {}, memory limit: {}"),
+            (flags & JOB_OBJECT_LIMIT_AFFINITY) != 0
+                ? std::format(U8("{:#x}"), info.BasicLimitInformation.Affinity)
+                : std::string{U8("unlimited")},
+            (flags & JOB_OBJECT_LIMIT_PRIORITY_CLASS) != 0
+                ? std::format(U8("{:#x}"), info.BasicLimitInformation.PriorityClass)
+                : std::string{U8("unlimited")},
+            (flags & JOB_OBJECT_LIMIT_JOB_MEMORY) != 0 ? std::format(U8("{} bytes"), info.JobMemoryLimit)
+                                                       : std::string{U8("unlimited")});
+    }
+
+    // Applies the affinity and the priorities to the calling thread and returns the effective settings. A very low I/O
+    // priority is the background mode, which also lowers the memory priority of the thread.
+    std::string apply_thread_resources(const service_config::resource_config& resources) {
+        const auto thread = GetCurrentThread();
+
+        if (has_affinity(resources) && !SetThreadAffinityMask(thread, get_effective_affinity(resources))) {
+            throw formatted_runtime_error{
+                U8("Message"), U8("Failed to set the thread affinity."), U8("Internal"), get_last_error()};
+        }
+
+        if (resources.io_priority == io_priority_level::very_low
+            && !SetThreadPriority(thread, THREAD_MODE_BACKGROUND_BEGIN)) {
+            throw formatted_runtime_error{
+                U8("Message"), U8("Failed to enter the background mode."), U8("Internal"), get_last_error()};
+        }
+
+        if (resources.priority && !SetThreadPriority(thread, get_thread_priority(*resources.priority))) {
+            throw formatted_runtime_error{
+                U8("Message"), U8("Failed to set the thread priority."), U8("Internal"), get_last_error()};
+        }
+
+        // Queries the mask rather than setting it again, which would pin the thread even without an affinity.
+        GROUP_AFFINITY affinity{};
+
+        return std::format(U8("affinity: {}, priority: {}, I/O priority: {}"),
+            GetThreadGroupAffinity(thread, &affinity) ? std::format(U8("{:#x}"), affinity.Mask)
+                                                      : std::string{U8("unknown")},
+            GetThreadPriority(thread),
+            resources.io_priority == io_priority_level::very_low ? U8("very low") : U8("normal"));
+    }
+} // namespace essence::win
@@ -20,6 +20,7 @@ namespace essence::win {
         static const default_values defaults{
             .standalone        = true,
             .post_quit_message = false,
+            .capture_output    = true,
             .working_directory = get_executing_directory(),
             .dll_directories   = {{get_executing_directory()}},
             .logger =
@@ -28,6 +29,54 @@ namespace essence::win {
                     .max_size  = U8("50 MiB"),
                     .max_files = 5U,
                 },
+            .stop =
+                {
+                    .grace_period        = 30000U,
+                    .checkpoint_interval = 1000U,
+                    .escalation          = stop_escalation::terminate_process,
+                    .signal              = stop_signal::terminate,
+                    .kill_timeout        = 10000U,
+                },
+            .readiness =
+                {
+                    .timeout        = 60000U,
+                    .probe_interval = 250U,
+                },
+            .supervisor =
+                {
+                    .policy          = restart_policy::never,
+                    .initial_backoff = 1000U,
+                    .max_backoff     = 60000U,
+                    .jitter          = 0.2,
+                    .max_restarts    = 5U,
+                    .restart_window  = 300000U,
+                    .warm_standby    = false,
+                },
+            .jvm =
+                {
+                    .jni_version  = U8("1.6"),
+                    .cds          = false,
+                    .isolated     = false,
+                    .entry_class  = U8("org.refvalue.SvcHostify"),
+                    .run_method   = U8("run"),
+                    .stop_method  = U8("onStop"),
+                    .channel_size = U8("64 KiB"),
+                },
+            .python =
+                {
+                    .run_function  = U8("run"),
+                    .stop_function = U8("on_stop"),
+                },
+            .dotnet =
+                {
+                    .run_method  = U8("Run"),
+                    .stop_method = U8("OnStop"),
+                },
+            .schedule =
+                {
+                    .jitter  = 0U,
+                    .release = true,
+                },
         };
 
         return defaults;
@@ -43,6 +43,161 @@ export namespace essence::win {
             std::optional<std::size_t> max_files;
         };
 
+        // All durations are in milliseconds.
+        struct stop_config {
+            enum class json_serialization {
+                camel_case,
+                enum_to_string,
+            };
+
+            std::optional<std::uint32_t> grace_period;
+            std::optional<std::uint32_t> checkpoint_interval;
+            std::optional<stop_escalation> escalation;
+            std::optional<std::uint32_t> preshutdown_timeout;
+            std::optional<stop_signal> signal;
+            std::optional<std::uint32_t> kill_timeout;
+        };
+
+        struct activation_config {
+            enum class json_serialization {
+                camel_case,
+                enum_to_string,
+            };
+
+            std::vector<std::uint16_t> ports;
+        };
+
+        struct replica_config {
+            enum class json_serialization {
+                camel_case,
+                enum_to_string,
+            };
+
+            std::uint32_t count{};
+            std::optional<bool> pin_cores;
+            std::optional<std::uint16_t> listen_port;
+        };
+
+        // All durations are in milliseconds.
+        struct heartbeat_config {
+            enum class json_serialization {
+                camel_case,
+                enum_to_string,
+            };
+
+            std::uint32_t deadline{};
+            std::optional<bool> restart;
+        };
+
+        // The affinity is a bit mask of logical processors, and the memory limit is a size like "512 MiB".
+        struct resource_config {
+            enum class json_serialization {
+                camel_case,
+                enum_to_string,
+            };
+
+            std::optional<std::uint64_t> affinity;
+            std::optional<priority_level> priority;
+            std::optional<std::string> memory_limit;
+            std::optional<io_priority_level> io_priority;
+            std::optional<std::uint16_t> numa_node;
+            std::optional<numa_memory_policy> numa_policy;
+        };
+
+        // The heap sizes are sizes like "512 MiB", and the JNI version is like "1.8" or "21". The entry class is a
+        // binary name like "org.refvalue.SvcHostify".
+        struct jvm_config {
+            enum class json_serialization {
+                camel_case,
+                enum_to_string,
+            };
+
+            std::optional<std::string> heap_min;
+            std::optional<std::string> heap_max;
+            std::optional<jvm_gc> gc;
+            std::optional<std::vector<std::string>> options;
+            std::optional<std::map<std::string, std::string>> properties;
+            std::optional<std::string> jni_version;
+            std::optional<bool> cds;
+            std::optional<bool> isolated;
+            std::optional<std::string> entry_class;
+            std::optional<std::string> run_method;
+            std::optional<std::string> stop_method;
+            std::optional<std::string> warmup;
+            std::optional<std::string> channel_size;
+            std::optional<std::uint32_t> metrics_interval;
+        };
+
+        // The home is the directory of a Python 3 installation holding python3.dll, and the paths are prepended to
+        // sys.path.
+        struct python_config {
+            enum class json_serialization {
+                camel_case,
+            };
+
+            std::optional<std::string> home;
+            std::optional<std::vector<std::string>> paths;
+            std::optional<std::string> run_function;
+            std::optional<std::string> stop_function;
+        };
+
+        // The root is the directory of a .NET installation, and the type is an assembly-qualified name like
+        // "Sample.Service, Sample".
+        struct dotnet_config {
+            enum class json_serialization {
+                camel_case,
+            };
+
+            std::optional<std::string> root;
+            std::optional<std::string> runtime_config;
+            std::optional<std::string> type;
+            std::optional<std::string> run_method;
+            std::optional<std::string> stop_method;
+        };
+
+        // Either an interval or a cron expression is set. All durations are in milliseconds.
+        struct schedule_config {
+            enum class json_serialization {
+                camel_case,
+                enum_to_string,
+            };
+
+            std::optional<std::uint32_t> interval;
+            std::optional<std::string> cron;
+            std::optional<std::uint32_t> jitter;
+            std::optional<std::uint32_t> run_timeout;
+            std::optional<bool> release;
+        };
+
+        // All durations are in milliseconds.
+        struct readiness_config {
+            enum class json_serialization {
+                camel_case,
+                enum_to_string,
+            };
+
+            readiness_probe probe{};
+            std::optional<std::uint16_t> port;
+            std::optional<std::uint32_t> timeout;
+            std::optional<std::uint32_t> probe_interval;
+        };
+
+        // All durations are in milliseconds.
+        struct supervisor_config {
+            enum class json_serialization {
+                camel_case,
+                enum_to_string,
+            };
+
+            std::optional<restart_policy> policy;
+            std::optional<std::uint32_t> initial_backoff;
+            std::optional<std::uint32_t> max_backoff;
+            std::optional<double> jitter;
+            std::optional<std::uint32_t> max_restarts;
+            std::optional<std::uint32_t> restart_window;
+            std::optional<bool> warm_standby;
+        };
+
         struct default_values {
             struct logger_defaults {
                 std::string base_path;
@@ -52,11 +207,67 @@ export namespace essence::win {
                 [[nodiscard]] logger_config to_config() const;
             };
 
+            struct stop_defaults {
+                std::uint32_t grace_period{};
+                std::uint32_t checkpoint_interval{};
+                stop_escalation escalation{};
+                stop_signal signal{};
+                std::uint32_t kill_timeout{};
+            };
+
+            struct readiness_defaults {
+                std::uint32_t timeout{};
+                std::uint32_t probe_interval{};
+            };
+
+            struct supervisor_defaults {
+                restart_policy policy{};
+                std::uint32_t initial_backoff{};
+                std::uint32_t max_backoff{};
+                double jitter{};
+                std::uint32_t max_restarts{};
+                std::uint32_t restart_window{};
+                bool warm_standby{};
+            };
+
+            struct jvm_defaults {
+                std::string jni_version;
+                bool cds{};
+                bool isolated{};
+                std::string entry_class;
+                std::string run_method;
+                std::string stop_method;
+                std::string channel_size;
+            };
+
+            struct python_defaults {
+                std::string run_function;
+                std::string stop_function;
+            };
+
+            struct dotnet_defaults {
+                std::string run_method;
+                std::string stop_method;
+            };
+
+            struct schedule_defaults {
+                std::uint32_t jitter{};
+                bool release{};
+            };
+
             bool standalone{};
             bool post_quit_message{};
+            bool capture_output{};
             std::string working_directory;
             std::vector<std::string> dll_directories;
             logger_defaults logger;
+            stop_defaults stop;
+            readiness_defaults readiness;
+            supervisor_defaults supervisor;
+            jvm_defaults jvm;
+            python_defaults python;
+            dotnet_defaults dotnet;
+            schedule_defaults schedule;
         };
 
         service_worker_type worker_type{service_worker_type::executable};
@@ -65,13 +276,26 @@ export namespace essence::win {
         std::string context;
         service_account_type account_type{service_account_type::local_service};
         std::optional<bool> standalone;
+        std::optional<std::string> host_group;
         std::optional<bool> post_quit_message;
+        std::optional<bool> capture_output;
+        std::optional<replica_config> replicas;
         std::optional<std::string> description;
         std::optional<std::string> jdk_directory;
         std::optional<std::string> working_directory;
         std::optional<std::vector<std::string>> arguments;
         std::optional<std::vector<std::string>> dll_directories;
         std::optional<logger_config> logger;
+        std::optional<stop_config> stop;
+        std::optional<activation_config> activation;
+        std::optional<readiness_config> readiness;
+        std::optional<supervisor_config> supervisor;
+        std::optional<heartbeat_config> heartbeat;
+        std::optional<schedule_config> schedule;
+        std::optional<resource_config> resources;
+        std::optional<jvm_config> jvm;
+        std::optional<python_config> python;
+        std::optional<dotnet_config> dotnet;
 
         [[nodiscard]] static const default_values& defaults();
         [[nodiscard]] static service_config from_msgpack_base64(std::string_view base64);
@@ -46,6 +46,22 @@ namespace essence::win {
         const auto system_directory    = std::filesystem::path{to_u8string(get_system_directory())};
         const auto svchost_executable  = from_u8string((system_directory / u8"svchost.exe").generic_u8string());
         const auto rundll32_executable = from_u8string((system_directory / u8"rundll32.exe").generic_u8string());
+
+        // The service account may update its state key, which anyone may read.
+        std::string make_service_state_security(service_account_type type) {
+            const auto account = [&] {
+                switch (type) {
+                case service_account_type::local_service:
+                    return U8("LS");
+                case service_account_type::network_service:
+                    return U8("NS");
+                default:
+                    return U8("SY");
+                }
+            }();
+
+            return format(U8("D:P(A;OICI;KA;;;SY)(A;OICI;KA;;;BA)(A;OICI;KR;;;BU)(A;OICI;KRKW;;;{})"), account);
+        }
     } // namespace
 
     class service_manager::impl {
@@ -53,20 +69,43 @@ namespace essence::win {
         explicit impl(service_config config)
             : config_{std::move(config)},
               standalone_{config_.standalone.value_or(service_config::defaults().standalone)},
+              host_group_{config_.host_group.value_or(std::string{})},
               checker_{make_service_error_checker(config_)}, service_name_{to_native_string(config_.name)},
               group_name_{format(U8("Broker_{}_{}"), config_.name, make_digest(digest_mode::sha3_224, config_.name))},
               group_key_{service_registry_keys::svchost_key},
-              service_param_key_{format(service_registry_keys::service_param_key_pattern, config_.name)} {
+              service_param_key_{format(service_registry_keys::service_param_key_pattern, config_.name)},
+              service_state_key_{format(service_registry_keys::service_state_key_pattern, config_.name)} {
             group_key_.push_back(filesystem_tokens::preferred_separator);
             group_key_.append(group_name_);
+
+            if (!host_group_.empty() && !standalone_) {
+                throw formatted_runtime_error{U8("Host Group"), host_group_, U8("Message"),
+                    U8("A host group is only applicable to a standalone service.")};
+            }
         }
 
         void install() const {
-            const auto path = standalone_ ? to_native_string(format(U8("{} \"{}\" service {}"), rundll32_executable,
-                                                get_executing_path(), to_utf8_string(service_name_)))
-                                          : to_native_string(format(U8("{} -k {}"), svchost_executable, group_name_));
+            if (!host_group_.empty()) {
+                check_host_group_account();
+            }
 
-            const auto service_type = standalone_ ? SERVICE_WIN32_OWN_PROCESS : SERVICE_WIN32_SHARE_PROCESS;
+            const auto path = [&] {
+                if (!standalone_) {
+                    return to_native_string(format(U8("{} -k {}"), svchost_executable, group_name_));
+                }
+
+                // All members of a host group share one image path so that the SCM starts them in one process.
+                if (!host_group_.empty()) {
+                    return to_native_string(format(
+                        U8("{} \"{}\" serviceGroup {}"), rundll32_executable, get_executing_path(), host_group_));
+                }
+
+                return to_native_string(format(U8("{} \"{}\" service {}"), rundll32_executable, get_executing_path(),
+                    to_utf8_string(service_name_)));
+            }();
+
+            const auto service_type =
+                standalone_ && host_group_.empty() ? SERVICE_WIN32_OWN_PROCESS : SERVICE_WIN32_SHARE_PROCESS;
 
             const sc_handle handle{CreateServiceW(ensure_scm().get(), service_name_.c_str(),
                 to_native_string(config_.display_name).c_str(), SERVICE_ALL_ACCESS, service_type, SERVICE_AUTO_START,
@@ -83,11 +122,25 @@ namespace essence::win {
                     U8("Failed to set the description of the service."));
             }
 
+            // Gives the service the time to drain before the system shutdown proceeds.
+            if (const auto stop = config_.stop.value_or(service_config::stop_config{}); stop.preshutdown_timeout) {
+                SERVICE_PRESHUTDOWN_INFO preshutdown_info{.dwPreshutdownTimeout = *stop.preshutdown_timeout};
+
+                checker_(ChangeServiceConfig2W(handle.get(), SERVICE_CONFIG_PRESHUTDOWN_INFO, &preshutdown_info),
+                    U8("Failed to set the preshutdown timeout of the service."));
+            }
+
             if (!standalone_) {
                 register_svchost();
             }
 
+            if (!host_group_.empty()) {
+                register_host_group();
+            }
+
             set_registry(service_param_key_, service_registry_keys::startup_configuration, config_.to_msgpack_base64());
+            create_registry_key(service_state_key_, make_service_state_security(config_.account_type));
+            set_registry(service_state_key_, service_registry_keys::restart_count, 0U);
         }
 
         void uninstall() const {
@@ -102,6 +155,12 @@ namespace essence::win {
             if (!standalone_) {
                 unregister_svchost();
             }
+
+            if (!host_group_.empty()) {
+                unregister_host_group();
+            }
+
+            unregister_service_state();
         }
 
         [[nodiscard]] bool installed() const {
@@ -146,13 +205,74 @@ namespace essence::win {
             spdlog::warn(ex.what());
         }
 
+        [[nodiscard]] std::vector<std::string> get_host_group_members() const {
+            std::vector<std::string> members;
+
+            if (const auto existing =
+                    try_get_registry_multi_string(service_registry_keys::host_group_key, host_group_)) {
+                members.assign(existing->begin(), existing->end());
+            }
+
+            return members;
+        }
+
+        // The SCM only starts the services of one shared process under the same account.
+        void check_host_group_account() const {
+            for (auto&& item : get_host_group_members()) {
+                if (item == config_.name) {
+                    continue;
+                }
+
+                const auto payload = try_get_registry_string(
+                    format(service_registry_keys::service_param_key_pattern, item),
+                    service_registry_keys::startup_configuration);
+
+                if (payload && service_config::from_msgpack_base64(*payload).account_type != config_.account_type) {
+                    throw formatted_runtime_error{U8("Host Group"), host_group_, U8("Member"), item, U8("Message"),
+                        U8("The members of a host group must run under the same account.")};
+                }
+            }
+        }
+
+        void register_host_group() const {
+            auto members = get_host_group_members();
+
+            if (std::ranges::find(members, config_.name) == members.end()) {
+                members.emplace_back(config_.name);
+            }
+
+            set_registry(service_registry_keys::host_group_key, host_group_, members);
+        }
+
+        void unregister_host_group() const try {
+            auto members = get_host_group_members();
+
+            std::erase(members, config_.name);
+
+            if (members.empty()) {
+                delete_registry(service_registry_keys::host_group_key, host_group_);
+            } else {
+                set_registry(service_registry_keys::host_group_key, host_group_, members);
+            }
+        } catch (const std::exception& ex) {
+            spdlog::warn(ex.what());
+        }
+
+        void unregister_service_state() const try {
+            delete_registry(service_state_key_);
+        } catch (const std::exception& ex) {
+            spdlog::warn(ex.what());
+        }
+
         service_config config_;
         bool standalone_;
+        std::string host_group_;
         error_checking_handler checker_;
         abi::nstring service_name_;
         std::string group_name_;
         std::string group_key_;
         std::string service_param_key_;
+        std::string service_state_key_;
     };
 
     service_manager::service_manager(service_config config) : impl_{std::make_unique<impl>(std::move(config))} {}
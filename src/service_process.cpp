@@ -33,52 +33,81 @@ module;
 
 module refvalue.svchostify;
 import :config_setup;
+import :cron_schedule;
+import :resource_limits;
 import :win32.svchost;
+import :worker_context;
+import essence.serialization;
 import std;
 
 namespace essence::win {
     namespace {
+        using kernel_handle = unique_handle<&CloseHandle>;
+
         constexpr DWORD pending_wait_hint = 10000;
-    }
+    } // namespace
+
+    void record_service_restart(std::string_view service_name);
+    void record_service_start(std::string_view service_name);
 
     class service_process::impl {
+        enum class wait_result {
+            ready,
+            not_ready,
+            exited,
+            stop_requested,
+            stalled,
+            timed_out,
+        };
+
     public:
-        impl()
-            : standalone_{!get_process_path().ends_with(U8("svchost.exe"))},
-              status_{.dwServiceType =
-                          static_cast<DWORD>(standalone_ ? SERVICE_WIN32_OWN_PROCESS : SERVICE_WIN32_SHARE_PROCESS)},
-              status_handle_{}, global_data_{} {}
+        impl() : standalone_{!get_process_path().ends_with(U8("svchost.exe"))}, primary_{}, global_data_{} {}
 
         static impl& self() noexcept {
             return *instance().impl_;
         }
 
         void init(zwstring_view service_name) {
-            service_name_.assign(service_name);
-            register_control_handler();
+            primary_ = &emplace_instance(
+                service_name, standalone_ ? SERVICE_WIN32_OWN_PROCESS : SERVICE_WIN32_SHARE_PROCESS);
+
+            if (!standalone_) {
+                primary_->register_control_handler();
+            }
         }
 
         void run(abstract::service_worker worker) {
-            worker_.emplace(std::move(worker));
+            primary_->assign(std::move(worker));
+            run_primary();
+        }
 
-            if (standalone_) {
-                static std::array entries{
-                    SERVICE_TABLE_ENTRYW{
-                        .lpServiceName = service_name_.data(),
-                        .lpServiceProc = &impl::service_main,
-                    },
-                    SERVICE_TABLE_ENTRYW{},
-                };
+        // The worker is created by the service thread once the start is pending, or upon activation.
+        void run(service_config config) {
+            primary_->assign(std::move(config), false);
+            run_primary();
+        }
 
-                StartServiceCtrlDispatcherW(entries.data());
+        void run_primary() {
+            if (standalone_) {
+                dispatch();
             } else {
-                start();
+                primary_->start();
             }
         }
 
+        void run_group(std::vector<service_config> configs) {
+            for (auto&& item : configs) {
+                emplace_instance(to_native_string(item.name), SERVICE_WIN32_SHARE_PROCESS)
+                    .assign(std::move(item), true);
+            }
+
+            dispatch();
+        }
+
         void report_stopped() {
-            report_status(SERVICE_STOPPED);
-            spdlog::info("The service has stopped.");
+            if (primary_) {
+                primary_->report_stopped();
+            }
         }
 
         void set_global_data(const void* data) noexcept {
@@ -86,100 +115,1027 @@ namespace essence::win {
         }
 
     private:
-        void register_control_handler(bool force = false) {
-            if (force || !standalone_) {
-                status_handle_ =
-                    RegisterServiceCtrlHandlerExW(service_name_.c_str(), &impl::service_ctrl_handler, this);
+        // Holds the state of one service so that services sharing the process are started and stopped independently.
+        class service_instance {
+        public:
+            service_instance(zwstring_view service_name, DWORD service_type)
+                : service_name_{service_name}, status_{.dwServiceType = service_type}, status_handle_{},
+                  check_point_{}, stop_event_{CreateEventW(nullptr, TRUE, FALSE, nullptr)},
+                  ready_event_{CreateEventW(nullptr, TRUE, FALSE, nullptr)}, running_reported_{}, restart_count_{},
+                  context_{std::make_shared<worker_context>()}, worker_attached_{}, logger_{spdlog::default_logger()} {}
+
+            [[nodiscard]] wchar_t* name() noexcept {
+                return service_name_.data();
             }
-        }
 
-        void run_business() try {
-            std::promise<void> promise;
-            std::jthread worker{[&] {
+            void assign(abstract::service_worker worker) {
+                config_.emplace(worker.config());
+                logger_ = make_service_logger(*config_);
+                worker_.emplace(std::move(worker));
+                worker_attached_ = false;
+            }
+
+            void assign(service_config config, bool dedicated_file) {
+                logger_ = make_service_logger(config, dedicated_file);
+                config_.emplace(std::move(config));
+            }
+
+            void register_control_handler() {
+                status_handle_ = RegisterServiceCtrlHandlerExW(service_name_.c_str(), &service_ctrl_handler, this);
+            }
+
+            void start() {
+                reset_state();
+                start_requested_at_ = std::chrono::steady_clock::now();
+                record_service_start(to_utf8_string(service_name_));
+                register_control_handler();
+
+                report_status(SERVICE_START_PENDING, pending_wait_hint);
+                logger_->info("The service start is pending.");
+
+                apply_numa_placement();
+                apply_process_limits();
+
+                if (config_->activation && !wait_for_activation()) {
+                    report_stopped();
+
+                    return;
+                }
+
+                // Closes the sockets however the run ends, so that a later start of the service can bind them again.
+                const scope_exit listeners_scope{[this] { close_listeners(); }};
+
+                if (config_->schedule) {
+                    run_schedule();
+                } else {
+                    try {
+                        start_worker();
+                    } catch (const std::exception&) {
+                        aggregate_error::throw_nested(formatted_runtime_error{U8("Failed to start the service.")});
+                    }
+
+                    // SERVICE_RUNNING is reported by the first run of the worker once it is ready.
+                    const scope_exit standby_scope{[this] { take_standby(); }};
+
+                    run_business();
+                }
+
+                log_counters();
+                close_listeners();
+                report_stopped();
+            }
+
+            void report_stopped() {
+                report_status(SERVICE_STOPPED);
+
+                if (const auto requested_at = stop_requested_at_.load(std::memory_order::acquire);
+                    requested_at != std::chrono::steady_clock::time_point{}) {
+                    logger_->info(U8("The service has stopped {} ms after the stop request."),
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - requested_at)
+                            .count());
+                } else {
+                    logger_->info("The service has stopped.");
+                }
+            }
+
+            void log_error(std::string_view message) const {
+                logger_->error(message);
+            }
+
+        private:
+            // A member of a shared process may be started again after it has stopped, so nothing of the previous
+            // start is kept but the worker, which is attached again to the new context.
+            void reset_state() {
+                close_listeners();
+                ResetEvent(stop_event_.get());
+                ResetEvent(ready_event_.get());
+                stop_requested_at_.store({}, std::memory_order::release);
+                restart_count_.store(0, std::memory_order::release);
+                running_reported_ = false;
+                activated_at_.reset();
+                run_deadline_.reset();
+                failed_at_.reset();
+                context_         = std::make_shared<worker_context>();
+                worker_attached_ = false;
+
+                std::scoped_lock lock{status_mutex_};
+
+                check_point_ = 0;
+            }
+
+            // Keeps reporting START_PENDING checkpoints while the worker is created, which takes minutes for a JVM
+            // generating its CDS archive.
+            abstract::service_worker create_worker() {
+                const std::jthread progress{[this](std::stop_token token) {
+                    std::mutex mutex;
+                    std::condition_variable_any condition;
+                    std::unique_lock lock{mutex};
+
+                    while (!condition.wait_for(
+                        lock, token, checkpoint_interval(), [&] { return token.stop_requested(); })) {
+                        report_start_progress();
+                    }
+                }};
+
+                return make_service_worker(*config_);
+            }
+
+            void start_worker() {
+                // The workers of a host group are created lazily, only for the services being started.
+                if (!worker_) {
+                    worker_.emplace(create_worker());
+                    worker_attached_ = false;
+                }
+
+                context_->set_logger(logger_);
+                context_->set_ready_handler([this] { SetEvent(ready_event_.get()); });
+                context_->set_listen_sockets(listeners_);
+
+                // A scheduled run reuses the worker, which is only attached once.
+                if (!worker_attached_) {
+                    worker_->attach(context_);
+                    worker_attached_ = true;
+                }
+
+                worker_->on_start();
+            }
+
+            // The runtime of an in-process worker, such as a JVM with its heap and threads, is not only set up by the
+            // thread running the worker, so the whole host is placed on the node when it owns the process. Windows
+            // allocates memory on the node of the processor touching it first, which keeps the memory local.
+            void apply_numa_placement() {
+                const auto& resources = config_->resources;
+
+                if (!resources || !resources->numa_node) {
+                    return;
+                }
+
+                if (resources->numa_policy == numa_memory_policy::interleave) {
+                    logger_->warn("Windows has no interleaved memory policy, the memory is allocated locally instead.");
+                }
+
+                if (config_->worker_type == service_worker_type::executable) {
+                    return;
+                }
+
+                if (status_.dwServiceType != SERVICE_WIN32_OWN_PROCESS) {
+                    logger_->warn("Only the worker thread is placed on the NUMA node in a shared process.");
+
+                    return;
+                }
+
+                const auto affinity = get_effective_affinity(*resources);
+
+                if (!SetProcessAffinityMask(GetCurrentProcess(), affinity)) {
+                    throw formatted_runtime_error{U8("NUMA Node"), *resources->numa_node, U8("Message"),
+                        U8("Failed to place the host on the NUMA node."), U8("Internal"), get_last_error()};
+                }
+
+                logger_->info(U8("The host has been placed on NUMA node {} with the affinity {:#x}."),
+                    *resources->numa_node, affinity);
+            }
+
+            // A thread cannot be limited in memory, so the limit of an in-process worker applies to the host process
+            // through a job, which would take down other services as well in a shared process. An executable worker
+            // applies the limits to the jobs of its children instead.
+            void apply_process_limits() {
+                const auto& resources = config_->resources;
+
+                if (!resources || !resources->memory_limit || config_->worker_type == service_worker_type::executable) {
+                    return;
+                }
+
+                if (status_.dwServiceType != SERVICE_WIN32_OWN_PROCESS) {
+                    logger_->warn("The memory limit is ignored in a shared process.");
+
+                    return;
+                }
+
+                kernel_handle job{CreateJobObjectW(nullptr, nullptr)};
+
+                if (!job) {
+                    throw formatted_runtime_error{
+                        U8("Message"), U8("Failed to create the job object."), U8("Internal"), get_last_error()};
+                }
+
+                apply_job_limits(job.get(), service_config::resource_config{.memory_limit = resources->memory_limit});
+
+                if (!AssignProcessToJobObject(job.get(), GetCurrentProcess())) {
+                    throw formatted_runtime_error{U8("Message"), U8("Failed to assign the host to the job object."),
+                        U8("Internal"), get_last_error()};
+                }
+
+                logger_->info(U8("Effective limits of the host process: {}"), describe_job_limits(job.get()));
+                resource_job_ = std::move(job);
+            }
+
+            void apply_thread_limits() const {
+                if (const auto& resources = config_->resources) {
+                    logger_->info(
+                        U8("Effective resources of the worker thread: {}"), apply_thread_resources(*resources));
+                }
+            }
+
+            // Binds the listening sockets and reports SERVICE_RUNNING while idle, so that the worker is only created
+            // upon the first connection. Returns false if the service is stopped before.
+            bool wait_for_activation() {
+                const auto& ports = config_->activation->ports;
+
                 try {
-                    worker_->run();
-                    promise.set_value();
+                    for (auto&& item : ports) {
+                        listeners_.emplace_back(make_listener(item));
+                    }
                 } catch (const std::exception&) {
-                    promise.set_exception(std::current_exception());
+                    close_listeners();
+                    aggregate_error::throw_nested(formatted_runtime_error{U8("Failed to activate the service.")});
+                }
+
+                report_running();
+                logger_->info(U8("Waiting for the first connection on ports {}."), json(ports).dump());
+
+                if (!wait_for_connection(listeners_, stop_event_.get())) {
+                    close_listeners();
+
+                    return false;
                 }
-            }};
 
-            // The cookie is a facade and does not need to be closed.
-            if (HANDLE cookie{}; global_data_ && global_data_->RegisterStopCallback) {
-                global_data_->RegisterStopCallback(
-                    &cookie, service_name_.c_str(), worker.native_handle(),
-                    [](void* context, BOOLEAN timeout) { static_cast<impl*>(context)->report_stopped(); }, this,
-                    WT_EXECUTEONLYONCE);
+                activated_at_ = std::chrono::steady_clock::now();
+                logger_->info(U8("The service has been activated with an idle working set of {} bytes."),
+                    get_working_set_size());
+
+                return true;
             }
 
-            promise.get_future().get();
-        } catch (const std::exception&) {
-            aggregate_error::throw_nested(formatted_runtime_error{U8("An error occurred during the service running.")});
-        }
+            void close_listeners() {
+                for (auto&& item : listeners_) {
+                    close_socket(item);
+                }
 
-        void start() {
-            register_control_handler(true);
+                listeners_.clear();
+            }
 
-            report_status(SERVICE_START_PENDING, pending_wait_hint);
-            spdlog::info("The service start is pending.");
+            void log_counters() const {
+                if (const auto counters = context_->counters(); !counters.empty()) {
+                    logger_->info(U8("Worker counters: {}"), json(counters).dump());
+                }
+            }
 
-            try {
-                worker_->on_start();
+            void run_business() try {
+                for (std::deque<std::chrono::steady_clock::time_point> restarts;;) {
+                    if (std::exception_ptr error; !run_worker(error) || !restart_worker(error, restarts)) {
+                        if (error) {
+                            std::rethrow_exception(error);
+                        }
+
+                        return;
+                    }
+                }
             } catch (const std::exception&) {
-                aggregate_error::throw_nested(formatted_runtime_error{U8("Failed to start the service.")});
+                aggregate_error::throw_nested(
+                    formatted_runtime_error{U8("An error occurred during the service running.")});
             }
 
-            report_status(SERVICE_RUNNING);
-            spdlog::info("The service is running.");
-            run_business();
-            report_stopped();
-        }
+            // Only the host stays resident between the runs, which never overlap as this thread makes them in turn.
+            void run_schedule() {
+                const auto& schedule = *config_->schedule;
+                std::optional<cron_schedule> cron;
 
-        void stop() {
-            report_status(SERVICE_STOP_PENDING, pending_wait_hint);
-            spdlog::info("The service stop is pending.");
+                try {
+                    if (schedule.interval.has_value() == schedule.cron.has_value() || schedule.interval == 0U) {
+                        throw formatted_runtime_error{
+                            U8("Either a positive interval or a cron expression must be set for the schedule.")};
+                    }
 
-            try {
-                worker_->on_stop();
-            } catch (...) {
+                    if (schedule.cron) {
+                        cron.emplace(*schedule.cron);
+                    }
+                } catch (const std::exception&) {
+                    aggregate_error::throw_nested(formatted_runtime_error{U8("Failed to start the service.")});
+                }
+
+                const std::chrono::milliseconds interval{schedule.interval.value_or(0U)};
+
+                report_running();
+
+                for (auto due_at = std::chrono::steady_clock::now() + interval;;) {
+                    // The wall clock is only read when computing the due time, a later change of it is not tracked.
+                    if (cron) {
+                        const auto now = std::chrono::system_clock::now();
+
+                        due_at = std::chrono::steady_clock::now()
+                               + (cron->next(now, *std::chrono::current_zone()) - now);
+                    }
+
+                    const auto delay = std::chrono::ceil<std::chrono::milliseconds>(
+                        due_at - std::chrono::steady_clock::now() + next_jitter(schedule));
+
+                    logger_->info(U8("The next run is due in {} ms."), delay.count());
+
+                    if (!wait_until(std::chrono::steady_clock::now() + delay)) {
+                        return;
+                    }
+
+                    const auto started_at      = std::chrono::steady_clock::now();
+                    const auto wall_started_at = std::chrono::system_clock::now();
+
+                    if (!run_scheduled()) {
+                        return;
+                    }
+
+                    std::uint64_t skipped{};
+
+                    if (cron) {
+                        for (auto time = cron->next(wall_started_at, *std::chrono::current_zone());
+                             time <= std::chrono::system_clock::now();
+                             time = cron->next(time, *std::chrono::current_zone())) {
+                            ++skipped;
+                        }
+                    } else {
+                        for (due_at += interval; due_at <= std::chrono::steady_clock::now(); due_at += interval) {
+                            ++skipped;
+                        }
+                    }
+
+                    if (skipped != 0) {
+                        logger_->warn(U8("{} due runs have been skipped, as the run took {} ms."), skipped,
+                            std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() - started_at)
+                                .count());
+                    }
+                }
+            }
+
+            // Makes a single run from the creation of the worker to its release. Returns false once the service is to
+            // stop, either upon a stop request or with the worker abandoned, which is kept in that case.
+            bool run_scheduled() {
+                const auto& schedule  = *config_->schedule;
+                const auto started_at = std::chrono::steady_clock::now();
+                std::exception_ptr error;
+
+                try {
+                    start_worker();
+                } catch (const std::exception&) {
+                    error = std::current_exception();
+                }
+
+                if (!error) {
+                    run_deadline_ = schedule.run_timeout
+                                      ? std::optional{started_at + std::chrono::milliseconds{*schedule.run_timeout}}
+                                      : std::nullopt;
+
+                    if (!run_worker(error)) {
+                        return false;
+                    }
+                }
+
+                if (error) {
+                    logger_->error(U8("The scheduled run has failed: {}"), describe_error(error));
+                } else {
+                    logger_->info(U8("The scheduled run has completed in {} ms."),
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - started_at)
+                            .count());
+                }
+
+                // A JVM cannot be created again in the same process.
+                if (schedule.release.value_or(service_config::defaults().schedule.release)
+                    && config_->worker_type != service_worker_type::jvm) {
+                    worker_.reset();
+                    worker_attached_ = false;
+                    logger_->info(U8("The worker has been released, leaving a working set of {} bytes."),
+                        get_working_set_size());
+                }
+
+                return true;
+            }
+
+            // Returns false if a stop is requested before the time.
+            [[nodiscard]] bool wait_until(std::chrono::steady_clock::time_point time) const {
+                for (auto now = std::chrono::steady_clock::now(); now < time; now = std::chrono::steady_clock::now()) {
+                    const auto timeout = std::min(std::chrono::ceil<std::chrono::milliseconds>(time - now),
+                        std::chrono::milliseconds{std::chrono::hours{24}});
+
+                    if (WaitForSingleObject(stop_event_.get(), static_cast<DWORD>(timeout.count())) == WAIT_OBJECT_0) {
+                        return false;
+                    }
+                }
+
+                return WaitForSingleObject(stop_event_.get(), 0) != WAIT_OBJECT_0;
+            }
+
+            [[nodiscard]] static std::chrono::milliseconds next_jitter(
+                const service_config::schedule_config& schedule) {
+                static thread_local std::mt19937 engine{std::random_device{}()};
+
+                std::uniform_int_distribution<std::uint32_t> distribution{
+                    0U, schedule.jitter.value_or(service_config::defaults().schedule.jitter)};
+
+                return std::chrono::milliseconds{distribution(engine)};
+            }
+
+            // Runs the worker once and returns whether it exited by itself rather than upon a stop request.
+            bool run_worker(std::exception_ptr& error) {
+                auto promise = std::make_shared<std::promise<void>>();
+                auto future  = promise->get_future();
+
+                run_started_at_ = std::chrono::steady_clock::now();
+                context_->beat();
+                context_->reset_stop();
+                ResetEvent(ready_event_.get());
+                std::thread worker{[this, promise] {
+                    try {
+                        apply_thread_limits();
+                        worker_->run();
+                        promise->set_value();
+                    } catch (const std::exception&) {
+                        promise->set_exception(std::current_exception());
+                    }
+                }};
+
+                // The cookie is a facade and does not need to be closed. A supervised worker may be restarted on a
+                // new thread, so the exit of the current one does not mean that the service has stopped.
+                if (HANDLE cookie{}; self().global_data_ && self().global_data_->RegisterStopCallback
+                                     && supervisor_policy() == restart_policy::never && !config_->schedule) {
+                    self().global_data_->RegisterStopCallback(
+                        &cookie, service_name_.c_str(), worker.native_handle(),
+                        [](void* context, BOOLEAN timeout) {
+                            static_cast<service_instance*>(context)->report_stopped();
+                        },
+                        this, WT_EXECUTEONLYONCE);
+                }
+
+                auto result = wait_ready(worker);
+
+                if (result == wait_result::ready) {
+                    log_cold_start();
+                    log_recovery();
+                    prepare_standby();
+                    result = wait_worker(worker);
+                }
+
+                if (result != wait_result::exited
+                    && !drain(worker,
+                        result == wait_result::stop_requested ? stop_requested_at_.load(std::memory_order::acquire)
+                                                              : std::chrono::steady_clock::now(),
+                        result == wait_result::stop_requested)) {
+                    worker.detach();
+
+                    return false;
+                }
+
+                worker.join();
+
+                try {
+                    future.get();
+                } catch (const std::exception&) {
+                    error = std::current_exception();
+                }
+
+                if (result == wait_result::stalled && !error) {
+                    error = std::make_exception_ptr(
+                        formatted_runtime_error{U8("The worker was stopped after missing its heartbeat deadline.")});
+                }
+
+                if (result == wait_result::timed_out && !error) {
+                    error = std::make_exception_ptr(
+                        formatted_runtime_error{U8("The worker was stopped after exceeding the run timeout.")});
+                }
+
+                if (result == wait_result::not_ready && !error) {
+                    error = std::make_exception_ptr(
+                        formatted_runtime_error{U8("The worker was stopped after failing to become ready in time.")});
+                }
+
+                return result != wait_result::stop_requested;
+            }
+
+            // Waits until the worker is able to serve, reporting START_PENDING checkpoints while the start is pending.
+            wait_result wait_ready(std::thread& worker) {
+                const auto& readiness = config_->readiness;
+
+                if (!readiness) {
+                    report_running();
+
+                    return wait_result::ready;
+                }
+
+                const auto& defaults = service_config::defaults().readiness;
+                const std::chrono::milliseconds timeout{readiness->timeout.value_or(defaults.timeout)};
+                const std::chrono::milliseconds probe_interval{
+                    readiness->probe_interval.value_or(defaults.probe_interval)};
+
+                // A notification arrives as an event, whereas the port is probed in between the waits.
+                const auto probe_port = readiness->probe == readiness_probe::port;
+                const auto slice      = probe_port ? probe_interval : checkpoint_interval();
+                const std::array handles{
+                    stop_event_.get(), static_cast<HANDLE>(worker.native_handle()), ready_event_.get()};
+
+                for (auto elapsed = std::chrono::steady_clock::now() - run_started_at_; elapsed < timeout;
+                     elapsed      = std::chrono::steady_clock::now() - run_started_at_) {
+                    if (probe_port && probe_local_port(*readiness->port, probe_interval)) {
+                        return on_ready();
+                    }
+
+                    const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(timeout - elapsed);
+
+                    switch (WaitForMultipleObjects(probe_port ? 2 : 3, handles.data(), FALSE,
+                        static_cast<DWORD>(std::min(slice, remaining).count()))) {
+                    case WAIT_OBJECT_0:
+                        return wait_result::stop_requested;
+                    case WAIT_OBJECT_0 + 2:
+                        return on_ready();
+                    case WAIT_TIMEOUT:
+                        break;
+                    default:
+                        return wait_result::exited;
+                    }
+
+                    if (!running_reported_) {
+                        report_status(SERVICE_START_PENDING, pending_wait_hint);
+                    }
+                }
+
+                logger_->error(U8("The worker did not become ready within {} ms."), timeout.count());
+
+                return wait_result::not_ready;
+            }
+
+            wait_result on_ready() {
+                logger_->info(U8("The worker is ready {} ms after it was started."),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - run_started_at_)
+                        .count());
+
+                report_running();
+
+                return wait_result::ready;
+            }
+
+            // The first connection of a socket-activated service waits for the whole startup of the worker.
+            void log_cold_start() {
+                if (const auto activated_at = std::exchange(activated_at_, std::nullopt)) {
+                    logger_->info(U8("The worker is ready {} ms after the first connection."),
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - *activated_at)
+                            .count());
+                }
+            }
+
+            // The time to recovery spans from the exit of the failed worker to the readiness of its replacement.
+            void log_recovery() {
+                if (const auto failed_at = std::exchange(failed_at_, std::nullopt)) {
+                    logger_->info(U8("The service has recovered {} ms after the worker exited."),
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - *failed_at)
+                            .count());
+                }
+            }
+
+            // The next standby is brought up in the background once the active worker is ready, so that both do not
+            // compete during a start.
+            void prepare_standby() {
+                if (!warm_standby() || standby_.valid()) {
+                    return;
+                }
+
+                standby_ = std::async(std::launch::async, [this] {
+                    const auto started_at = std::chrono::steady_clock::now();
+                    auto standby          = make_standby_service_worker(*config_);
+
+                    standby.attach(context_);
+                    standby.prepare();
+                    logger_->info(U8("The warm standby is ready {} ms after it was started."),
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - started_at)
+                            .count());
+
+                    return standby;
+                });
+            }
+
+            // Returns the prepared standby, or nothing if the worker is to be restarted instead. Waits for a standby
+            // still being prepared, which is faster than a cold restart anyway.
+            std::optional<abstract::service_worker> take_standby() {
+                if (!standby_.valid()) {
+                    return std::nullopt;
+                }
+
+                try {
+                    return standby_.get();
+                } catch (const std::exception& ex) {
+                    logger_->warn(U8("The warm standby is unavailable: {}"), ex.what());
+
+                    return std::nullopt;
+                }
+            }
+
+            // Only the first run changes the state, a restarted worker runs while the service is already running.
+            void report_running() {
+                if (std::exchange(running_reported_, true)) {
+                    return;
+                }
+
+                report_status(SERVICE_RUNNING);
+                logger_->info(U8("The service is running {} ms after the start request."),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start_requested_at_)
+                        .count());
+            }
+
+            // Waits until the worker returns by itself or a stop request arrives, checking the heartbeat in between.
+            wait_result wait_worker(std::thread& worker) {
+                const auto heartbeat = config_->heartbeat;
+                const std::array handles{stop_event_.get(), static_cast<HANDLE>(worker.native_handle())};
+                const std::chrono::milliseconds deadline{heartbeat ? heartbeat->deadline : 0U};
+                const auto timeout = heartbeat ? static_cast<DWORD>(std::max<std::int64_t>(deadline.count() / 4, 1))
+                                               : INFINITE;
+
+                for (auto stalled = false;;) {
+                    auto current_timeout = timeout;
+
+                    if (run_deadline_) {
+                        const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+                            *run_deadline_ - std::chrono::steady_clock::now());
+
+                        current_timeout = std::min(
+                            current_timeout, static_cast<DWORD>(std::max<std::int64_t>(remaining.count(), 0)));
+                    }
+
+                    switch (WaitForMultipleObjects(2, handles.data(), FALSE, current_timeout)) {
+                    case WAIT_OBJECT_0:
+                        return wait_result::stop_requested;
+                    case WAIT_TIMEOUT:
+                        break;
+                    default:
+                        return wait_result::exited;
+                    }
+
+                    if (run_deadline_ && std::chrono::steady_clock::now() >= *run_deadline_) {
+                        return wait_result::timed_out;
+                    }
+
+                    if (!heartbeat) {
+                        continue;
+                    }
+
+                    // Only an atomic read on the regular path, the report is issued once per stall.
+                    if (const auto elapsed = context_->since_last_beat(); elapsed <= deadline) {
+                        if (std::exchange(stalled, false)) {
+                            logger_->info(U8("The worker has resumed its heartbeat."));
+                        }
+                    } else if (!std::exchange(stalled, true)) {
+                        report_stall(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed));
+
+                        if (heartbeat->restart.value_or(false)) {
+                            return wait_result::stalled;
+                        }
+                    }
+                }
+            }
+
+            void report_stall(std::chrono::milliseconds elapsed) const {
+                struct flight_state {
+                    enum class json_serialization {
+                        camel_case,
+                    };
+
+                    std::string service_name;
+                    std::int64_t last_beat_age{};
+                    std::int64_t running_for{};
+                    std::uint32_t restart_count{};
+                    std::uint32_t check_point{};
+                    bool stop_requested{};
+                    std::map<std::string, std::int64_t> counters;
+                };
+
+                logger_->error(U8("The worker has missed its heartbeat deadline, the last beat was {} ms ago."),
+                    elapsed.count());
+
+                logger_->error(U8("Flight state: {}"),
+                    json(flight_state{
+                             .service_name  = to_utf8_string(service_name_),
+                             .last_beat_age = elapsed.count(),
+                             .running_for   = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now() - run_started_at_)
+                                                .count(),
+                             .restart_count = restart_count_.load(std::memory_order::acquire),
+                             .check_point   = check_point_,
+                             .stop_requested =
+                                 stop_requested_at_.load(std::memory_order::acquire)
+                                 != std::chrono::steady_clock::time_point{},
+                             .counters = context_->counters(),
+                         })
+                        .dump(4));
+            }
+
+            // Applies the supervisor policy after the worker has exited by itself. Returns false if the service is to
+            // stop, leaving the error to be reported in that case.
+            bool restart_worker(
+                std::exception_ptr& error, std::deque<std::chrono::steady_clock::time_point>& restarts) {
+                const auto& defaults  = service_config::defaults().supervisor;
+                const auto supervisor = config_->supervisor.value_or(service_config::supervisor_config{});
+                const auto policy     = supervisor_policy();
+
+                if (policy == restart_policy::never || (policy == restart_policy::on_failure && !error)) {
+                    return false;
+                }
+
+                const std::chrono::milliseconds restart_window{
+                    supervisor.restart_window.value_or(defaults.restart_window)};
+                const auto max_restarts = supervisor.max_restarts.value_or(defaults.max_restarts);
+
+                for (;;) {
+                    const auto exited_at = std::chrono::steady_clock::now();
+
+                    if (error) {
+                        logger_->warn(U8("The worker has failed: {}"), describe_error(error));
+                    } else {
+                        logger_->warn("The worker has returned.");
+                    }
+
+                    while (!restarts.empty() && exited_at - restarts.front() > restart_window) {
+                        restarts.pop_front();
+                    }
+
+                    if (restarts.size() >= max_restarts) {
+                        logger_->error(U8("Crash loop detected: {} restarts within {} ms, stopping the service."),
+                            restarts.size(), restart_window.count());
+
+                        return false;
+                    }
+
+                    // A failover skips the backoff, but still counts as a restart against crash loops.
+                    auto standby = take_standby();
+
+                    if (!standby) {
+                        const auto backoff = next_backoff(supervisor, restarts.size());
+
+                        logger_->info(U8("Restarting the worker in {} ms."), backoff.count());
+
+                        if (WaitForSingleObject(stop_event_.get(), static_cast<DWORD>(backoff.count()))
+                            == WAIT_OBJECT_0) {
+                            error = nullptr;
+
+                            return false;
+                        }
+                    }
+
+                    const auto restarting_at = std::chrono::steady_clock::now();
+
+                    restarts.push_back(restarting_at);
+
+                    // The worker object is kept unless a standby takes over, so the loaded DLL or the JVM is reused
+                    // by the next run.
+                    try {
+                        if (standby) {
+                            // The standby has been attached while being prepared.
+                            worker_.emplace(std::move(*standby));
+                            worker_attached_ = true;
+                            logger_->info("The warm standby has been promoted.");
+                        }
+
+                        worker_->on_start();
+                    } catch (const std::exception&) {
+                        error = std::current_exception();
+                        continue;
+                    }
+
+                    const auto count = restart_count_.fetch_add(1, std::memory_order::acq_rel) + 1;
+
+                    error      = nullptr;
+                    failed_at_ = exited_at;
+                    record_service_restart(to_utf8_string(service_name_));
+                    logger_->info(U8("The worker has been restarted (#{}) in {} ms, {} ms after it exited."), count,
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - restarting_at)
+                            .count(),
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - exited_at)
+                            .count());
+
+                    return true;
+                }
+            }
+
+            [[nodiscard]] restart_policy supervisor_policy() const {
+                return config_->supervisor.value_or(service_config::supervisor_config{})
+                    .policy.value_or(service_config::defaults().supervisor.policy);
+            }
+
+            [[nodiscard]] bool warm_standby() const {
+                return !config_->schedule && supervisor_policy() != restart_policy::never
+                    && config_->supervisor.value_or(service_config::supervisor_config{})
+                           .warm_standby.value_or(service_config::defaults().supervisor.warm_standby);
+            }
+
+            [[nodiscard]] static std::chrono::milliseconds next_backoff(
+                const service_config::supervisor_config& supervisor, std::size_t restarts) {
+                static thread_local std::mt19937 engine{std::random_device{}()};
+
+                const auto& defaults = service_config::defaults().supervisor;
+                const auto initial = static_cast<double>(supervisor.initial_backoff.value_or(defaults.initial_backoff));
+                const auto maximum = static_cast<double>(supervisor.max_backoff.value_or(defaults.max_backoff));
+                const auto jitter  = std::clamp(supervisor.jitter.value_or(defaults.jitter), 0.0, 1.0);
+                const auto backoff = std::min(initial * std::pow(2.0, static_cast<double>(restarts)), maximum);
+
+                std::uniform_real_distribution distribution{1.0 - jitter, 1.0 + jitter};
+
+                return std::chrono::milliseconds{static_cast<std::int64_t>(backoff * distribution(engine))};
+            }
+
+            static std::string describe_error(const std::exception_ptr& error) {
+                try {
+                    std::rethrow_exception(error);
+                } catch (const std::exception& ex) {
+                    return ex.what();
+                } catch (...) {
+                    return U8("Unknown error.");
+                }
+            }
+
+            // Waits for the worker to return after it has been asked to stop, reporting progress to the SCM if
+            // needed and escalating once the grace period is over. Returns false if the worker has been abandoned.
+            bool drain(std::thread& worker, std::chrono::steady_clock::time_point requested_at, bool report_progress) {
+                const auto& defaults = service_config::defaults().stop;
+                const auto stop      = config_->stop.value_or(service_config::stop_config{});
+                const std::chrono::milliseconds grace_period{stop.grace_period.value_or(defaults.grace_period)};
+
+                context_->request_stop();
+
+                // The thread holds the worker, so that a late notification never reaches a promoted standby.
+                std::thread{[this, worker = *worker_] {
+                    try {
+                        worker.on_stop();
+                    } catch (const std::exception& ex) {
+                        logger_->warn(U8("Failed to notify the worker to stop: {}"), ex.what());
+                    }
+                }}.detach();
+
+                for (auto elapsed = std::chrono::steady_clock::now() - requested_at; elapsed < grace_period;
+                     elapsed      = std::chrono::steady_clock::now() - requested_at) {
+                    const auto timeout = std::min(checkpoint_interval(),
+                        std::chrono::ceil<std::chrono::milliseconds>(grace_period - elapsed));
+
+                    if (WaitForSingleObject(worker.native_handle(), static_cast<DWORD>(timeout.count()))
+                        == WAIT_OBJECT_0) {
+                        return true;
+                    }
+
+                    if (report_progress) {
+                        report_status(SERVICE_STOP_PENDING, stop_wait_hint());
+                    }
+                }
+
+                logger_->warn(U8("The worker did not stop within the grace period of {} ms."), grace_period.count());
+
+                if (stop.escalation.value_or(defaults.escalation) == stop_escalation::terminate_process) {
+                    // Terminating a shared process would take down the other services as well.
+                    if (status_.dwServiceType == SERVICE_WIN32_OWN_PROCESS) {
+                        report_stopped();
+                        logger_->flush();
+                        TerminateProcess(GetCurrentProcess(), ERROR_SERVICE_REQUEST_TIMEOUT);
+                    }
+
+                    logger_->warn("The process is shared with other services and will not be terminated.");
+                }
+
+                logger_->warn("The worker has been abandoned.");
+
+                return false;
+            }
+
+            void request_stop() {
+                if (auto expected = std::chrono::steady_clock::time_point{};
+                    !stop_requested_at_.compare_exchange_strong(
+                        expected, std::chrono::steady_clock::now(), std::memory_order::acq_rel)) {
+                    return;
+                }
+
+                report_status(SERVICE_STOP_PENDING, stop_wait_hint());
+                logger_->info("The service stop is pending.");
+                SetEvent(stop_event_.get());
+            }
+
+            [[nodiscard]] std::chrono::milliseconds checkpoint_interval() const {
+                return std::chrono::milliseconds{config_->stop.value_or(service_config::stop_config{})
+                        .checkpoint_interval.value_or(service_config::defaults().stop.checkpoint_interval)};
+            }
+
+            [[nodiscard]] DWORD stop_wait_hint() const {
+                return static_cast<DWORD>(checkpoint_interval().count() * 2);
+            }
+
+            static DWORD WINAPI service_ctrl_handler(DWORD control, DWORD event_type, void* event_data, void* context) {
+                switch (control) {
+                case SERVICE_CONTROL_STOP:
+                case SERVICE_CONTROL_PRESHUTDOWN:
+                    // Returns immediately and leaves the draining to the thread running the service.
+                    static_cast<service_instance*>(context)->request_stop();
+                    break;
+                case SERVICE_CONTROL_INTERROGATE:
+                    [[fallthrough]];
+                default:
+                    break;
+                }
+
+                return NO_ERROR;
             }
+
+            // Only advances the check point, as an activated service has already reported SERVICE_RUNNING.
+            void report_start_progress() {
+                std::scoped_lock lock{status_mutex_};
+
+                if (status_.dwCurrentState == SERVICE_START_PENDING) {
+                    status_.dwCheckPoint = ++check_point_;
+                    static_cast<void>(SetServiceStatus(status_handle_, &status_));
+                }
+            }
+
+            void report_status(DWORD current_state, DWORD wait_hint = {}) {
+                std::scoped_lock lock{status_mutex_};
+
+                status_.dwCurrentState     = current_state;
+                status_.dwWaitHint         = wait_hint;
+                status_.dwControlsAccepted =
+                    current_state == SERVICE_START_PENDING ? 0U : SERVICE_ACCEPT_STOP | SERVICE_ACCEPT_PRESHUTDOWN;
+                status_.dwCheckPoint =
+                    (current_state == SERVICE_RUNNING || current_state == SERVICE_STOPPED) ? 0U : ++check_point_;
+
+                static_cast<void>(SetServiceStatus(status_handle_, &status_));
+            }
+
+            abi::wstring service_name_;
+            SERVICE_STATUS status_;
+            SERVICE_STATUS_HANDLE status_handle_;
+            DWORD check_point_;
+            std::mutex status_mutex_;
+            kernel_handle stop_event_;
+            kernel_handle ready_event_;
+            bool running_reported_;
+            std::atomic<std::chrono::steady_clock::time_point> stop_requested_at_;
+            std::atomic_uint32_t restart_count_;
+            std::chrono::steady_clock::time_point start_requested_at_;
+            std::optional<std::chrono::steady_clock::time_point> activated_at_;
+            std::vector<std::uintptr_t> listeners_;
+            std::chrono::steady_clock::time_point run_started_at_;
+            std::optional<std::chrono::steady_clock::time_point> run_deadline_;
+            std::shared_ptr<worker_context> context_;
+            kernel_handle resource_job_;
+            std::optional<service_config> config_;
+            std::optional<abstract::service_worker> worker_;
+            bool worker_attached_;
+            std::future<abstract::service_worker> standby_;
+            std::optional<std::chrono::steady_clock::time_point> failed_at_;
+            std::shared_ptr<spdlog::logger> logger_;
+        };
+
+        service_instance& emplace_instance(zwstring_view service_name, DWORD service_type) {
+            return *instances_.emplace_back(std::make_unique<service_instance>(service_name, service_type));
         }
 
-        static void service_main(DWORD argc, wchar_t** argv) {
-            self().start();
+        service_instance* find_instance(std::wstring_view service_name) noexcept {
+            const auto iter = std::ranges::find_if(
+                instances_, [&](const auto& inner) { return std::wstring_view{inner->name()} == service_name; });
+
+            return iter == instances_.end() ? primary_ : iter->get();
         }
 
-        static DWORD WINAPI service_ctrl_handler(DWORD control, DWORD event_type, void* event_data, void* context) {
-            switch (control) {
-            case SERVICE_CONTROL_STOP:
-                static_cast<impl*>(context)->stop();
-                break;
-            case SERVICE_CONTROL_INTERROGATE:
-                [[fallthrough]];
-            default:
-                break;
-            }
+        void dispatch() {
+            auto entries = instances_ | std::views::transform([](const auto& inner) {
+                return SERVICE_TABLE_ENTRYW{
+                    .lpServiceName = inner->name(),
+                    .lpServiceProc = &impl::service_main,
+                };
+            }) | std::ranges::to<std::vector>();
 
-            return NO_ERROR;
+            entries.emplace_back();
+
+            if (!StartServiceCtrlDispatcherW(entries.data())) {
+                throw formatted_runtime_error{U8("Message"), U8("Failed to start the service control dispatcher."),
+                    U8("Internal"), get_last_error()};
+            }
         }
 
-        void report_status(DWORD current_state, DWORD wait_hint = {}) {
-            static DWORD check_point{};
+        static void WINAPI service_main(DWORD argc, wchar_t** argv) {
+            auto* const instance = self().find_instance(argc == 0 ? std::wstring_view{} : argv[0]);
 
-            status_.dwCurrentState     = current_state;
-            status_.dwWaitHint         = wait_hint;
-            status_.dwControlsAccepted = current_state == SERVICE_START_PENDING ? 0U : SERVICE_ACCEPT_STOP;
-            status_.dwCheckPoint =
-                (current_state == SERVICE_RUNNING || current_state == SERVICE_STOPPED) ? 0U : ++check_point;
+            if (instance == nullptr) {
+                return;
+            }
 
-            static_cast<void>(SetServiceStatus(status_handle_, &status_));
+            // Keeps a failure of one service from tearing down the others sharing the process.
+            try {
+                instance->start();
+            } catch (const std::exception& ex) {
+                instance->log_error(ex.what());
+                instance->report_stopped();
+            }
         }
 
         bool standalone_;
-        SERVICE_STATUS status_;
-        SERVICE_STATUS_HANDLE status_handle_;
-        std::optional<abstract::service_worker> worker_;
-        abi::wstring service_name_;
+        std::vector<std::unique_ptr<service_instance>> instances_;
+        service_instance* primary_;
         const SVCHOST_GLOBAL_DATA* global_data_;
     };
 
@@ -199,6 +1155,14 @@ namespace essence::win {
         impl_->run(std::move(worker));
     }
 
+    void service_process::run(service_config config) const {
+        impl_->run(std::move(config));
+    }
+
+    void service_process::run_group(std::vector<service_config> configs) const {
+        impl_->run_group(std::move(configs));
+    }
+
     void service_process::report_stopped() const {
         impl_->report_stopped();
     }
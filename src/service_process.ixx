@@ -22,6 +22,7 @@
 
 export module refvalue.svchostify:service_process;
 import :abstract.service_worker;
+import :service_config;
 import essence.basic;
 import std;
 
@@ -36,6 +37,8 @@ export namespace essence::win {
         static const service_process& instance();
         void init(zwstring_view service_name) const;
         void run(abstract::service_worker worker) const;
+        void run(service_config config) const;
+        void run_group(std::vector<service_config> configs) const;
         void report_stopped() const;
         void set_global_data(const void* data) const noexcept;
 
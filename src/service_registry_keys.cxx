@@ -33,13 +33,21 @@ namespace essence::win {
         static constexpr std::string_view svchost_key{
             U8(R"(HKLM\SOFTWARE\Microsoft\Windows NT\CurrentVersion\Svchost)")};
 
+        static constexpr std::string_view host_group_key{U8(R"(HKLM\SOFTWARE\RefValue\SvcHostify\Groups)")};
+
         static constexpr std::string_view service_param_key_pattern{
             U8(R"(HKLM\SYSTEM\CurrentControlSet\Services\{}\Parameters)")};
 
+        // Unlike the parameters, it is writable by the service account.
+        static constexpr std::string_view service_state_key_pattern{
+            U8(R"(HKLM\SOFTWARE\RefValue\SvcHostify\Services\{})")};
+
         static constexpr std::string_view co_initialize_security_param{U8("CoInitializeSecurityParam")};
+        static constexpr std::string_view restart_count{U8("RestartCount")};
         static constexpr std::string_view service_dll{U8("ServiceDll")};
         static constexpr std::string_view service_dll_unload_on_stop{U8("ServiceDllUnloadOnStop")};
         static constexpr std::string_view service_main{U8("ServiceMain")};
+        static constexpr std::string_view start_time{U8("StartTime")};
         static constexpr std::string_view startup_configuration{U8("StartupConfiguration")};
     };
 } // namespace essence::win
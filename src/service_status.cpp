@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2024 The RefValue Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+module;
+
+#include <essence/char8_t_remediation.hpp>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NOGDI
+
+#include <Windows.h>
+
+module refvalue.svchostify;
+import :registry;
+import :service_registry_keys;
+import essence.basic;
+import std;
+
+namespace essence::win {
+    namespace {
+        using sc_handle = unique_handle<&CloseServiceHandle>;
+
+        constexpr std::size_t initial_enumeration_buffer_size = 256 * 1024;
+
+        service_state to_service_state(DWORD state) noexcept {
+            switch (state) {
+            case SERVICE_STOPPED:
+                return service_state::stopped;
+            case SERVICE_START_PENDING:
+                return service_state::start_pending;
+            case SERVICE_STOP_PENDING:
+                return service_state::stop_pending;
+            case SERVICE_RUNNING:
+                return service_state::running;
+            case SERVICE_CONTINUE_PENDING:
+                return service_state::continue_pending;
+            case SERVICE_PAUSE_PENDING:
+                return service_state::pause_pending;
+            case SERVICE_PAUSED:
+                return service_state::paused;
+            default:
+                return service_state::unknown;
+            }
+        }
+
+        std::uint64_t get_system_time() noexcept {
+            FILETIME time{};
+
+            GetSystemTimeAsFileTime(&time);
+
+            return static_cast<std::uint64_t>(time.dwHighDateTime) << 32U | time.dwLowDateTime;
+        }
+
+        class win32_service_status_backend {
+        public:
+            [[nodiscard]] static std::vector<service_status_record> enumerate_services() {
+                const sc_handle scm{OpenSCManagerW(nullptr, nullptr, SC_MANAGER_ENUMERATE_SERVICE)};
+
+                if (!scm) {
+                    throw formatted_runtime_error{U8("Message"), U8("Failed to open the Service Control Manager."),
+                        U8("Internal"), get_last_error()};
+                }
+
+                std::vector<service_status_record> result;
+                std::vector<std::byte> buffer(initial_enumeration_buffer_size);
+
+                // Retrieves all entries in a single pass, only growing the buffer when the SCM asks for more.
+                for (DWORD resume_handle{};;) {
+                    DWORD bytes_needed{};
+                    DWORD count{};
+
+                    const auto success = EnumServicesStatusExW(scm.get(), SC_ENUM_PROCESS_INFO, SERVICE_WIN32,
+                        SERVICE_STATE_ALL, reinterpret_cast<LPBYTE>(buffer.data()), static_cast<DWORD>(buffer.size()),
+                        &bytes_needed, &count, &resume_handle, nullptr);
+
+                    if (!success && GetLastError() != ERROR_MORE_DATA) {
+                        throw formatted_runtime_error{
+                            U8("Message"), U8("Failed to enumerate the services."), U8("Internal"), get_last_error()};
+                    }
+
+                    const std::span entries{
+                        reinterpret_cast<const ENUM_SERVICE_STATUS_PROCESSW*>(buffer.data()), count};
+
+                    result.reserve(result.size() + entries.size());
+
+                    for (auto&& item : entries) {
+                        result.push_back({
+                            .name         = to_utf8_string(item.lpServiceName),
+                            .display_name = to_utf8_string(item.lpDisplayName),
+                            .state        = to_service_state(item.ServiceStatusProcess.dwCurrentState),
+                            .process_id   = item.ServiceStatusProcess.dwProcessId,
+                        });
+                    }
+
+                    if (success) {
+                        break;
+                    }
+
+                    buffer.resize(std::max<std::size_t>(buffer.size(), bytes_needed));
+                }
+
+                return result;
+            }
+
+            [[nodiscard]] static std::optional<std::string> get_startup_configuration(std::string_view service_name) {
+                return try_get_registry_string(format(service_registry_keys::service_param_key_pattern, service_name),
+                    service_registry_keys::startup_configuration);
+            }
+
+            [[nodiscard]] static std::optional<std::uint32_t> get_restart_count(std::string_view service_name) {
+                return try_get_registry_dword(format(service_registry_keys::service_state_key_pattern, service_name),
+                    service_registry_keys::restart_count);
+            }
+
+            // The start time is recorded per service, as the members of a host group share a single process.
+            [[nodiscard]] static std::optional<std::chrono::seconds> get_service_uptime(std::string_view service_name) {
+                const auto start_time = try_get_registry_qword(
+                    format(service_registry_keys::service_state_key_pattern, service_name),
+                    service_registry_keys::start_time);
+
+                if (!start_time) {
+                    return std::nullopt;
+                }
+
+                // Both timestamps are counted in 100-nanosecond intervals.
+                const auto now = get_system_time();
+
+                return std::chrono::duration_cast<std::chrono::seconds>(
+                    std::chrono::duration<std::uint64_t, std::ratio<1, 10'000'000>>{now - std::min(now, *start_time)});
+            }
+        };
+    } // namespace
+
+    abstract::service_status_backend make_service_status_backend() {
+        return abstract::service_status_backend{win32_service_status_backend{}};
+    }
+
+    std::vector<service_status> query_service_statuses() {
+        return query_service_statuses(make_service_status_backend());
+    }
+
+    std::vector<service_status> query_service_statuses(const abstract::service_status_backend& backend) {
+        std::vector<service_status> result;
+
+        for (auto&& item : backend.enumerate_services()) {
+            // Only services carrying a startup configuration are managed by this host.
+            const auto payload = backend.get_startup_configuration(item.name);
+
+            if (!payload) {
+                continue;
+            }
+
+            auto& status = result.emplace_back(service_status{
+                .name         = std::move(item.name),
+                .display_name = std::move(item.display_name),
+                .state        = item.state,
+                .process_id   = item.process_id,
+            });
+
+            try {
+                status.worker_type = service_config::from_msgpack_base64(*payload).worker_type;
+            } catch (const std::exception& ex) {
+                spdlog::warn(U8("Failed to decode the startup configuration of {}: {}"), status.name, ex.what());
+            }
+
+            if (status.state == service_state::running) {
+                if (const auto uptime = backend.get_service_uptime(status.name)) {
+                    status.uptime_seconds = static_cast<std::uint64_t>(uptime->count());
+                }
+            }
+
+            status.restart_count = backend.get_restart_count(status.name);
+        }
+
+        return result;
+    }
+
+    // Only the restarts made by the supervisor are counted, as a start by the SCM looks like a manual one.
+    void record_service_restart(std::string_view service_name) try {
+        const auto key   = format(service_registry_keys::service_state_key_pattern, service_name);
+        const auto count = try_get_registry_dword(key, service_registry_keys::restart_count).value_or(0U);
+
+        set_registry(key, service_registry_keys::restart_count, count + 1U);
+    } catch (const std::exception& ex) {
+        spdlog::warn(U8("Failed to record the service restart: {}"), ex.what());
+    }
+
+    void record_service_start(std::string_view service_name) try {
+        set_registry(format(service_registry_keys::service_state_key_pattern, service_name),
+            service_registry_keys::start_time, get_system_time());
+    } catch (const std::exception& ex) {
+        spdlog::warn(U8("Failed to record the service start: {}"), ex.what());
+    }
+} // namespace essence::win
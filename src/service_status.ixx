@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024 The RefValue Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+export module refvalue.svchostify:service_status;
+import :abstract.service_status_backend;
+import :common_types;
+import std;
+
+export namespace essence::win {
+    struct service_status {
+        enum class json_serialization {
+            camel_case,
+            enum_to_string,
+        };
+
+        std::string name;
+        std::string display_name;
+        service_state state{service_state::unknown};
+        std::uint32_t process_id{};
+        std::optional<service_worker_type> worker_type;
+        std::optional<std::uint64_t> uptime_seconds;
+        std::optional<std::uint32_t> restart_count;
+    };
+
+    abstract::service_status_backend make_service_status_backend();
+    std::vector<service_status> query_service_statuses();
+    std::vector<service_status> query_service_statuses(const abstract::service_status_backend& backend);
+} // namespace essence::win
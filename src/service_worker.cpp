@@ -31,32 +31,63 @@ import :service_registry_keys;
 
 namespace essence::win {
     abstract::service_worker make_executable_service_worker(service_config config);
-    abstract::service_worker make_pure_c_service_worker(service_config config);
+    abstract::service_worker make_pure_c_service_worker(service_config config, bool private_copy);
     abstract::service_worker make_com_service_worker(service_config config);
     abstract::service_worker make_jvm_service_worker(service_config config);
+    abstract::service_worker make_python_service_worker(service_config config);
+    abstract::service_worker make_dotnet_service_worker(service_config config);
 
     abstract::service_worker make_service_worker(service_config config) {
         switch (config.worker_type) {
         case service_worker_type::executable:
             return make_executable_service_worker(std::move(config));
         case service_worker_type::pure_c:
-            return make_pure_c_service_worker(std::move(config));
+            return make_pure_c_service_worker(std::move(config), false);
         case service_worker_type::com:
             return make_com_service_worker(std::move(config));
         case service_worker_type::jvm:
             return make_jvm_service_worker(std::move(config));
+        case service_worker_type::python:
+            return make_python_service_worker(std::move(config));
+        case service_worker_type::dotnet:
+            return make_dotnet_service_worker(std::move(config));
         default:
             throw formatted_runtime_error{U8("Invalid worker type.")};
         }
     }
 
+    // A standby lives next to the active worker, so a DLL is loaded from a private copy to get its own globals. A JVM
+    // cannot be created twice in a process.
+    abstract::service_worker make_standby_service_worker(service_config config) {
+        switch (config.worker_type) {
+        case service_worker_type::executable:
+            return make_executable_service_worker(std::move(config));
+        case service_worker_type::pure_c:
+            return make_pure_c_service_worker(std::move(config), true);
+        default:
+            throw formatted_runtime_error{U8("A warm standby requires a pure_c or executable worker.")};
+        }
+    }
+
     abstract::service_worker make_service_worker_from_registry(zwstring_view service_name) {
-        auto config = service_config::from_msgpack_base64(
-            get_registry_string(format(service_registry_keys::service_param_key_pattern, to_utf8_string(service_name)),
-                service_registry_keys::startup_configuration));
+        auto config = load_service_config_from_registry(service_name);
 
         setup_config(config, true);
 
         return make_service_worker(std::move(config));
     }
+
+    service_config load_service_config_from_registry(zwstring_view service_name) {
+        return service_config::from_msgpack_base64(
+            get_registry_string(format(service_registry_keys::service_param_key_pattern, to_utf8_string(service_name)),
+                service_registry_keys::startup_configuration));
+    }
+
+    std::vector<service_config> load_host_group_from_registry(zwstring_view group_name) {
+        return get_registry_multi_string(service_registry_keys::host_group_key, to_utf8_string(group_name))
+             | std::views::transform([](const auto& inner) {
+                   return load_service_config_from_registry(to_native_string(inner));
+               })
+             | std::ranges::to<std::vector>();
+    }
 } // namespace essence::win
@@ -6,5 +6,8 @@ import std;
 
 export namespace essence::win {
     abstract::service_worker make_service_worker(service_config config);
+    abstract::service_worker make_standby_service_worker(service_config config);
     abstract::service_worker make_service_worker_from_registry(zwstring_view service_name);
+    service_config load_service_config_from_registry(zwstring_view service_name);
+    std::vector<service_config> load_host_group_from_registry(zwstring_view group_name);
 } // namespace essence::win
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2024 The RefValue Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+module;
+
+#include <essence/char8_t_remediation.hpp>
+
+module refvalue.svchostify:spsc_ring;
+import essence.basic;
+import std;
+
+namespace essence::win {
+    // A lock-free single-producer single-consumer ring of records over memory owned by the caller, laid out so that
+    // it can be shared with another runtime such as Java through a direct ByteBuffer. The head and the tail are
+    // 64-bit byte positions growing forever, each on a cache line of its own, followed by the capacity and the data.
+    // A record is a 32-bit payload size, a 32-bit type and the payload, padded to 8 bytes. A record not fitting
+    // before the end of the data is preceded by a padding record of type 0 filling the rest.
+    class spsc_ring {
+    public:
+        static constexpr std::size_t head_offset     = 0;
+        static constexpr std::size_t tail_offset     = 64;
+        static constexpr std::size_t capacity_offset = 128;
+        static constexpr std::size_t data_offset     = 192;
+        static constexpr std::size_t header_size     = 8;
+        static constexpr std::uint32_t padding_type  = 0;
+
+        // The capacity must be a power of two and the memory aligned to 8 bytes.
+        spsc_ring(std::byte* memory, std::size_t capacity) noexcept : memory_{memory}, capacity_{capacity} {
+            head().store(0, std::memory_order::relaxed);
+            tail().store(0, std::memory_order::relaxed);
+            std::atomic_ref{*reinterpret_cast<std::uint64_t*>(memory_ + capacity_offset)}.store(
+                capacity_, std::memory_order::release);
+        }
+
+        [[nodiscard]] static constexpr std::size_t size_of(std::size_t capacity) noexcept {
+            return data_offset + capacity;
+        }
+
+        // Returns false if the ring is full, or the record is larger than the ring.
+        bool push(std::uint32_t type, std::span<const std::byte> payload) noexcept {
+            const auto record = align(header_size + payload.size());
+
+            if (record > capacity_) {
+                return false;
+            }
+
+            auto position      = tail().load(std::memory_order::relaxed);
+            const auto used    = position - head().load(std::memory_order::acquire);
+            const auto offset  = position & (capacity_ - 1);
+            const auto padding = capacity_ - offset < record ? capacity_ - offset : 0;
+
+            if (capacity_ - used < record + padding) {
+                return false;
+            }
+
+            if (padding != 0) {
+                write_header(offset, 0, padding_type);
+                position += padding;
+            }
+
+            const auto start = position & (capacity_ - 1);
+
+            write_header(start, static_cast<std::uint32_t>(payload.size()), type);
+            std::memcpy(data() + start + header_size, payload.data(), payload.size());
+            tail().store(position + record, std::memory_order::release);
+
+            return true;
+        }
+
+        // Hands every pending record to the handler as (type, payload), releasing them at once afterwards.
+        template <std::invocable<std::uint32_t, std::span<const std::byte>> Handler>
+        std::size_t drain(Handler&& handler) {
+            auto position     = head().load(std::memory_order::relaxed);
+            const auto end    = tail().load(std::memory_order::acquire);
+            std::size_t count = 0;
+
+            const scope_exit release{[&] { head().store(position, std::memory_order::release); }};
+
+            while (position != end) {
+                const auto offset = position & (capacity_ - 1);
+                std::uint32_t size{};
+                std::uint32_t type{};
+
+                std::memcpy(&size, data() + offset, sizeof(size));
+                std::memcpy(&type, data() + offset + sizeof(size), sizeof(type));
+
+                if (type == padding_type) {
+                    position += capacity_ - offset;
+                    continue;
+                }
+
+                // A corrupted record stops the draining instead of reading past the data.
+                if (header_size + size > capacity_ - offset) {
+                    position = end;
+                    break;
+                }
+
+                position += align(header_size + size);
+                ++count;
+                handler(type, std::span<const std::byte>{data() + offset + header_size, size});
+            }
+
+            return count;
+        }
+
+    private:
+        static constexpr std::size_t align(std::size_t size) noexcept {
+            return (size + 7) & ~std::size_t{7};
+        }
+
+        std::atomic_ref<std::uint64_t> head() const noexcept {
+            return std::atomic_ref{*reinterpret_cast<std::uint64_t*>(memory_ + head_offset)};
+        }
+
+        std::atomic_ref<std::uint64_t> tail() const noexcept {
+            return std::atomic_ref{*reinterpret_cast<std::uint64_t*>(memory_ + tail_offset)};
+        }
+
+        std::byte* data() const noexcept {
+            return memory_ + data_offset;
+        }
+
+        void write_header(std::size_t offset, std::uint32_t size, std::uint32_t type) noexcept {
+            std::memcpy(data() + offset, &size, sizeof(size));
+            std::memcpy(data() + offset + sizeof(size), &type, sizeof(type));
+        }
+
+        std::byte* memory_;
+        std::size_t capacity_;
+    };
+} // namespace essence::win
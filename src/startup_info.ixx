@@ -27,6 +27,7 @@ export namespace essence::win {
     struct startup_info {
         bool install{};
         bool uninstall{};
+        bool status{};
         std::string config_file;
     };
 } // namespace essence::win
@@ -1,10 +1,12 @@
 export module refvalue.svchostify;
 
+export import :abstract.service_status_backend;
 export import :common_types;
 export import :config_setup;
 export import :service_config;
 export import :service_manager;
 export import :service_process;
+export import :service_status;
 export import :service_worker;
 export import :startup_info;
 export import :util;
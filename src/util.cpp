@@ -30,7 +30,9 @@ module;
 
 #include <essence/char8_t_remediation.hpp>
 
+#include <WinSock2.h>
 #include <Windows.h>
+#include <Psapi.h>
 #include <shellapi.h>
 
 module refvalue.svchostify;
@@ -156,6 +158,154 @@ namespace essence::win {
         return joint;
     }
 
+    std::wstring make_environment_block(std::span<const std::pair<std::string, std::string>> variables) {
+        const std::unique_ptr<wchar_t, decltype([](wchar_t* inner) { FreeEnvironmentStringsW(inner); })> strings{
+            GetEnvironmentStringsW()};
+
+        const auto native_variables = variables | std::views::transform([](const auto& inner) {
+            return std::pair{to_native_string(inner.first), to_native_string(inner.second)};
+        }) | std::ranges::to<std::vector>();
+
+        // Names are case-insensitive, and a leading '=' belongs to the name of a hidden variable.
+        const auto overridden = [&](std::wstring_view entry) {
+            const auto name = entry.substr(0, entry.find(L'=', 1));
+
+            return std::ranges::any_of(native_variables, [&](const auto& inner) {
+                return CompareStringOrdinal(name.data(), static_cast<int>(name.size()), inner.first.c_str(),
+                           static_cast<int>(inner.first.size()), TRUE)
+                    == CSTR_EQUAL;
+            });
+        };
+
+        std::wstring result;
+
+        for (auto iter = strings.get(); iter != nullptr && *iter != L'\0'; iter += std::wcslen(iter) + 1) {
+            if (const std::wstring_view entry{iter}; !overridden(entry)) {
+                result.append(entry);
+                result.push_back(L'\0');
+            }
+        }
+
+        for (auto&& [name, value] : native_variables) {
+            result.append(name);
+            result.push_back(L'=');
+            result.append(value);
+            result.push_back(L'\0');
+        }
+
+        result.push_back(L'\0');
+
+        return result;
+    }
+
+    void ensure_winsock() {
+        static const auto result = [] {
+            WSADATA data{};
+
+            return WSAStartup(MAKEWORD(2, 2), &data);
+        }();
+
+        if (result != 0) {
+            throw formatted_runtime_error{U8("Message"), U8("Failed to initialize Winsock."), U8("Internal"),
+                get_system_error(static_cast<std::uint32_t>(result))};
+        }
+    }
+
+    bool probe_local_port(std::uint16_t port, std::chrono::milliseconds timeout) {
+        ensure_winsock();
+
+        const auto handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+        if (handle == INVALID_SOCKET) {
+            return false;
+        }
+
+        const std::unique_ptr<const SOCKET, decltype([](const SOCKET* inner) { closesocket(*inner); })> guard{&handle};
+
+        // Connects without blocking, so that a refused connection does not wait for the retries of the stack.
+        u_long non_blocking = 1;
+        const sockaddr_in address{
+            .sin_family = AF_INET,
+            .sin_port   = htons(port),
+            .sin_addr   = {.S_un = {.S_addr = htonl(INADDR_LOOPBACK)}},
+        };
+
+        if (ioctlsocket(handle, FIONBIO, &non_blocking) != 0
+            || (connect(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+                && WSAGetLastError() != WSAEWOULDBLOCK)) {
+            return false;
+        }
+
+        fd_set writable{.fd_count = 1, .fd_array = {handle}};
+        fd_set failed{.fd_count = 1, .fd_array = {handle}};
+        const timeval interval{
+            .tv_sec  = static_cast<long>(timeout.count() / 1000),
+            .tv_usec = static_cast<long>(timeout.count() % 1000 * 1000),
+        };
+
+        return select(0, nullptr, &writable, &failed, &interval) > 0 && writable.fd_count != 0;
+    }
+
+    // Sockets are created inheritable, so that the listener can be handed to child processes.
+    std::uintptr_t make_listener(std::uint16_t port) {
+        ensure_winsock();
+
+        const auto listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+        if (listener == INVALID_SOCKET) {
+            throw formatted_runtime_error{U8("Port"), port, U8("Message"), U8("Failed to create the socket."),
+                U8("Internal"), get_system_error(static_cast<std::uint32_t>(WSAGetLastError()))};
+        }
+
+        const sockaddr_in address{
+            .sin_family = AF_INET,
+            .sin_port   = htons(port),
+            .sin_addr   = {.S_un = {.S_addr = htonl(INADDR_ANY)}},
+        };
+
+        if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+            || listen(listener, SOMAXCONN) != 0) {
+            const auto code = WSAGetLastError();
+
+            closesocket(listener);
+
+            throw formatted_runtime_error{U8("Port"), port, U8("Message"), U8("Failed to listen on the port."),
+                U8("Internal"), get_system_error(static_cast<std::uint32_t>(code))};
+        }
+
+        return listener;
+    }
+
+    void close_socket(std::uintptr_t socket) noexcept {
+        closesocket(socket);
+    }
+
+    // Returns false if the stop event has been signaled first. The pending connection is left to the worker.
+    bool wait_for_connection(std::span<const std::uintptr_t> sockets, void* stop_event) {
+        const std::unique_ptr<void, decltype(&WSACloseEvent)> accept_event{WSACreateEvent(), &WSACloseEvent};
+
+        for (auto&& item : sockets) {
+            WSAEventSelect(item, accept_event.get(), FD_ACCEPT);
+        }
+
+        const std::array handles{stop_event, accept_event.get()};
+        const auto result = WaitForMultipleObjects(2, handles.data(), FALSE, INFINITE);
+
+        // Cancels the association, which also made the sockets non-blocking.
+        for (u_long non_blocking = 0; auto&& item : sockets) {
+            WSAEventSelect(item, nullptr, 0);
+            ioctlsocket(item, FIONBIO, &non_blocking);
+        }
+
+        return result == WAIT_OBJECT_0 + 1;
+    }
+
+    std::size_t get_working_set_size() {
+        PROCESS_MEMORY_COUNTERS counters{.cb = sizeof(PROCESS_MEMORY_COUNTERS)};
+
+        return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0U;
+    }
+
     void allocate_console_and_redirect() {
         AllocConsole();
 
@@ -14,6 +14,13 @@ export namespace essence::win {
     zwstring_view get_service_account_name(service_account_type type);
     std::vector<abi::string> parse_command_line(zwstring_view command_line);
     abi::wstring make_command_line(std::span<const std::string> args);
+    std::wstring make_environment_block(std::span<const std::pair<std::string, std::string>> variables);
+    void ensure_winsock();
+    bool probe_local_port(std::uint16_t port, std::chrono::milliseconds timeout);
+    std::uintptr_t make_listener(std::uint16_t port);
+    void close_socket(std::uintptr_t socket) noexcept;
+    bool wait_for_connection(std::span<const std::uintptr_t> sockets, void* stop_event);
+    std::size_t get_working_set_size();
     void allocate_console_and_redirect();
     void add_dll_directories(std::span<const std::string> directories);
 } // namespace essence::win
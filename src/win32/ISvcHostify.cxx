@@ -35,4 +35,16 @@ struct __declspec(novtable, uuid("CB62E85F-0C69-C76B-E955-655E0D184E5A")) ISvcHo
     virtual STDMETHODIMP OnStop()             = 0;
 };
 
+// Implemented by the host and handed to the coclass if it implements ISvcHostifyHostAware.
+struct __declspec(novtable, uuid("5A7C2E14-8B3D-4F6A-9C21-D4E8F0B13A67")) ISvcHostifyHost : IUnknown {
+    virtual STDMETHODIMP Heartbeat()   = 0;
+    virtual STDMETHODIMP NotifyReady() = 0;
+};
+
+struct __declspec(novtable, uuid("9E3B6D51-2F84-4C7A-B0D9-71A5C3E8F426")) ISvcHostifyHostAware : IUnknown {
+    virtual STDMETHODIMP Attach(ISvcHostifyHost* host) = 0;
+};
+
 _COM_SMARTPTR_TYPEDEF(ISvcHostify, __uuidof(ISvcHostify));
+_COM_SMARTPTR_TYPEDEF(ISvcHostifyHost, __uuidof(ISvcHostifyHost));
+_COM_SMARTPTR_TYPEDEF(ISvcHostifyHostAware, __uuidof(ISvcHostifyHostAware));
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2024 The RefValue Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+module refvalue.svchostify:worker_context;
+import essence.basic;
+import std;
+
+namespace essence::win {
+    // The state shared between the host and a running worker, updated by the worker through its runtime-specific
+    // channel. The heartbeat is read by the host without any synchronization beyond atomics.
+    class worker_context {
+    public:
+        worker_context() noexcept : last_beat_{now()}, stop_requested_{} {}
+
+        [[nodiscard]] const std::shared_ptr<spdlog::logger>& logger() const noexcept {
+            return logger_;
+        }
+
+        void set_logger(std::shared_ptr<spdlog::logger> logger) noexcept {
+            logger_ = std::move(logger);
+        }
+
+        // The listening sockets bound by the host for a socket-activated service.
+        [[nodiscard]] std::span<const std::uintptr_t> listen_sockets() const noexcept {
+            return listen_sockets_;
+        }
+
+        void set_listen_sockets(std::vector<std::uintptr_t> sockets) noexcept {
+            listen_sockets_ = std::move(sockets);
+        }
+
+        void set_ready_handler(std::function<void()> handler) noexcept {
+            ready_handler_ = std::move(handler);
+        }
+
+        // Called by the worker once it is able to serve.
+        void notify_ready() const {
+            if (ready_handler_) {
+                ready_handler_();
+            }
+        }
+
+        void beat() noexcept {
+            last_beat_.store(now(), std::memory_order::relaxed);
+        }
+
+        [[nodiscard]] std::chrono::steady_clock::duration since_last_beat() const noexcept {
+            return std::chrono::steady_clock::duration{now() - last_beat_.load(std::memory_order::relaxed)};
+        }
+
+        void request_stop() {
+            {
+                std::scoped_lock lock{stop_mutex_};
+
+                stop_requested_ = true;
+            }
+
+            stop_condition_.notify_all();
+        }
+
+        // Called before each run, so that a restarted worker does not see the stop of its predecessor.
+        void reset_stop() {
+            std::scoped_lock lock{stop_mutex_};
+
+            stop_requested_ = false;
+        }
+
+        [[nodiscard]] bool stop_requested() const {
+            std::scoped_lock lock{stop_mutex_};
+
+            return stop_requested_;
+        }
+
+        // Returns whether the stop has been requested within the timeout.
+        bool wait_for_stop(std::optional<std::chrono::milliseconds> timeout) const {
+            std::unique_lock lock{stop_mutex_};
+
+            if (!timeout) {
+                stop_condition_.wait(lock, [this] { return stop_requested_; });
+
+                return true;
+            }
+
+            return stop_condition_.wait_for(lock, *timeout, [this] { return stop_requested_; });
+        }
+
+        void add_counter(std::string_view name, std::int64_t delta) {
+            std::scoped_lock lock{counter_mutex_};
+
+            if (const auto iter = counters_.find(name); iter != counters_.end()) {
+                iter->second += delta;
+            } else {
+                counters_.emplace(name, delta);
+            }
+        }
+
+        [[nodiscard]] std::map<std::string, std::int64_t> counters() const {
+            std::scoped_lock lock{counter_mutex_};
+
+            return {counters_.begin(), counters_.end()};
+        }
+
+    private:
+        static std::chrono::steady_clock::rep now() noexcept {
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+        }
+
+        std::shared_ptr<spdlog::logger> logger_;
+        std::function<void()> ready_handler_;
+        std::vector<std::uintptr_t> listen_sockets_;
+        std::atomic<std::chrono::steady_clock::rep> last_beat_;
+        mutable std::mutex stop_mutex_;
+        mutable std::condition_variable stop_condition_;
+        bool stop_requested_;
+        mutable std::mutex counter_mutex_;
+        std::map<std::string, std::int64_t, std::less<>> counters_;
+    };
+} // namespace essence::win
@@ -36,6 +36,7 @@ import :abstract.service_worker;
 import :service_config;
 import :service_worker;
 import :win32.ISvcHostify;
+import :worker_context;
 import essence.basic;
 import std;
 
@@ -79,6 +80,59 @@ namespace essence::win {
             return array;
         }
 
+        class svchostify_host final : public ISvcHostifyHost {
+        public:
+            explicit svchostify_host(std::shared_ptr<worker_context> context)
+                : ref_count_{1}, context_{std::move(context)} {}
+
+            STDMETHODIMP QueryInterface(REFIID iid, void** object) override {
+                if (object == nullptr) {
+                    return E_POINTER;
+                }
+
+                if (iid == __uuidof(IUnknown) || iid == __uuidof(ISvcHostifyHost)) {
+                    *object = static_cast<ISvcHostifyHost*>(this);
+                    AddRef();
+
+                    return S_OK;
+                }
+
+                *object = nullptr;
+
+                return E_NOINTERFACE;
+            }
+
+            STDMETHODIMP_(ULONG) AddRef() override {
+                return ref_count_.fetch_add(1, std::memory_order::relaxed) + 1;
+            }
+
+            STDMETHODIMP_(ULONG) Release() override {
+                const auto count = ref_count_.fetch_sub(1, std::memory_order::acq_rel) - 1;
+
+                if (count == 0) {
+                    delete this;
+                }
+
+                return count;
+            }
+
+            STDMETHODIMP Heartbeat() override {
+                context_->beat();
+
+                return S_OK;
+            }
+
+            STDMETHODIMP NotifyReady() override {
+                context_->notify_ready();
+
+                return S_OK;
+            }
+
+        private:
+            std::atomic<ULONG> ref_count_;
+            std::shared_ptr<worker_context> context_;
+        };
+
         class com_service_worker {
         public:
             explicit com_service_worker(service_config config) : config_{std::move(config)} {
@@ -99,6 +153,15 @@ namespace essence::win {
                 return config_;
             }
 
+            [[maybe_unused]] void attach(const std::shared_ptr<worker_context>& context) const {
+                if (const ISvcHostifyHostAwarePtr aware{broker_}) {
+                    const ISvcHostifyHostPtr host{new svchostify_host{context}, false};
+
+                    check_com_error(aware->Attach(host), U8("CLSID"), config_.context, U8("Message"),
+                        U8("An error occurred inside the ISvcHostify instance when attaching the host."));
+                }
+            }
+
             [[maybe_unused]] static void on_start() noexcept {}
 
             void on_stop() const {
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2024 The RefValue Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+module;
+
+#include <essence/char8_t_remediation.hpp>
+#include <essence/compat.hpp>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NOGDI
+
+#include <Windows.h>
+
+module refvalue.svchostify;
+import :abstract.service_worker;
+import :service_config;
+import :service_worker;
+import :util;
+import :worker_context;
+import essence.basic;
+import std;
+
+namespace essence::win {
+    namespace {
+        using unique_module  = unique_handle<&FreeLibrary>;
+        using hostfxr_handle = void*;
+
+        // The values and the signatures of hostfxr.h and coreclr_delegates.h, without depending on the SDK.
+        constexpr std::int32_t hdt_load_assembly_and_get_function_pointer = 5;
+
+        using hostfxr_initialize_for_runtime_config_ptr = std::int32_t (*)(
+            const wchar_t* runtime_config_path, const void* parameters, hostfxr_handle* host_context_handle);
+        using hostfxr_get_runtime_delegate_ptr =
+            std::int32_t (*)(hostfxr_handle host_context_handle, std::int32_t type, void** delegate);
+        using hostfxr_close_ptr                          = std::int32_t (*)(hostfxr_handle host_context_handle);
+        using load_assembly_and_get_function_pointer_ptr = std::int32_t (*)(const wchar_t* assembly_path,
+            const wchar_t* type_name, const wchar_t* method_name, const wchar_t* delegate_type_name, void* reserved,
+            void** delegate);
+
+        using dotnet_run_ptr     = void (*)(std::int32_t argc, const char* argv[]);
+        using dotnet_on_stop_ptr = void (*)();
+
+        // Stands for a method marked with [UnmanagedCallersOnly] in place of a delegate type name.
+        const wchar_t* unmanaged_callers_only_method() noexcept {
+            return reinterpret_cast<const wchar_t*>(static_cast<std::intptr_t>(-1));
+        }
+
+        // The status codes of hostfxr are HRESULT-like, negative on failures.
+        std::string to_status(std::int32_t code) {
+            return format(U8("{:#010x}"), static_cast<std::uint32_t>(code));
+        }
+
+        std::optional<std::filesystem::path> get_environment_path(const wchar_t* name) {
+            std::wstring buffer(MAX_PATH, L'\0');
+
+            for (;;) {
+                const auto size = GetEnvironmentVariableW(name, buffer.data(), static_cast<DWORD>(buffer.size()));
+
+                if (size == 0) {
+                    return std::nullopt;
+                }
+
+                if (size < buffer.size()) {
+                    buffer.resize(size);
+
+                    return std::filesystem::path{buffer};
+                }
+
+                buffer.resize(size);
+            }
+        }
+
+        // The root follows the lookup of the dotnet muxer: the configured one, DOTNET_ROOT and then Program Files.
+        std::filesystem::path get_dotnet_root(const service_config& config) {
+            if (config.dotnet && config.dotnet->root) {
+                return std::filesystem::path{to_u8string(*config.dotnet->root)};
+            }
+
+            if (auto root = get_environment_path(L"DOTNET_ROOT")) {
+                return std::move(*root);
+            }
+
+            if (const auto program_files = get_environment_path(L"ProgramFiles")) {
+                return *program_files / u8"dotnet";
+            }
+
+            throw formatted_runtime_error{U8("Failed to locate the .NET installation.")};
+        }
+
+        // Picks host/fxr/<version>/hostfxr.dll of the highest version, ignoring any prerelease suffix.
+        std::filesystem::path find_hostfxr(const std::filesystem::path& root) {
+            const auto to_version = [](const std::filesystem::path& path) {
+                const auto name = from_u8string(path.filename().generic_u8string());
+
+                return std::string_view{name}.substr(0, name.find(U8('-'))) | std::views::split(U8('.'))
+                     | std::views::transform([](const auto& inner) {
+                           return from_string<std::uint32_t>(std::string_view{inner.begin(), inner.end()})
+                               .value_or(0);
+                       })
+                     | std::ranges::to<std::vector>();
+            };
+
+            std::optional<std::filesystem::path> result;
+            std::vector<std::uint32_t> best;
+
+            if (std::error_code code; std::filesystem::is_directory(root / u8"host" / u8"fxr", code)) {
+                for (auto&& item : std::filesystem::directory_iterator{root / u8"host" / u8"fxr"}) {
+                    const auto path = item.path() / u8"hostfxr.dll";
+
+                    if (auto version = to_version(item.path());
+                        std::filesystem::is_regular_file(path) && (!result || version > best)) {
+                        result = path;
+                        best   = std::move(version);
+                    }
+                }
+            }
+
+            if (!result) {
+                throw formatted_runtime_error{U8(".NET Root"), from_u8string(root.generic_u8string()), U8("Message"),
+                    U8("Failed to find hostfxr.dll in the .NET installation.")};
+            }
+
+            return std::move(*result);
+        }
+
+        class dotnet_host {
+        public:
+            // The first worker loading hostfxr decides the installation, as the runtime is never unloaded.
+            explicit dotnet_host(const service_config& config)
+                : initialize_{}, get_runtime_delegate_{}, close_{} {
+                const auto path = find_hostfxr(get_dotnet_root(config));
+
+                if (module_.reset(
+                        LoadLibraryExW(path.generic_wstring().c_str(), nullptr, LOAD_LIBRARY_SEARCH_DEFAULT_DIRS));
+                    !module_) {
+                    throw formatted_runtime_error{U8("hostfxr"), from_u8string(path.generic_u8string()),
+                        U8("Message"), U8("Failed to load hostfxr."), U8("Internal"), get_last_error()};
+                }
+
+                load_function(U8("hostfxr_initialize_for_runtime_config"), initialize_);
+                load_function(U8("hostfxr_get_runtime_delegate"), get_runtime_delegate_);
+                load_function(U8("hostfxr_close"), close_);
+            }
+
+            // Starts the runtime upon the first call, the later ones must be compatible with the runtime started.
+            [[nodiscard]] load_assembly_and_get_function_pointer_ptr get_loader(
+                const std::filesystem::path& runtime_config) const {
+                hostfxr_handle handle{};
+
+                if (const auto code = initialize_(runtime_config.generic_wstring().c_str(), nullptr, &handle);
+                    code < 0 || handle == nullptr) {
+                    throw formatted_runtime_error{U8("Runtime Config"),
+                        from_u8string(runtime_config.generic_u8string()), U8("Code"), to_status(code), U8("Message"),
+                        U8("Failed to initialize the .NET runtime.")};
+                }
+
+                const scope_exit handle_scope{[&] { close_(handle); }};
+                void* delegate{};
+
+                if (const auto code =
+                        get_runtime_delegate_(handle, hdt_load_assembly_and_get_function_pointer, &delegate);
+                    code < 0 || delegate == nullptr) {
+                    throw formatted_runtime_error{U8("Code"), to_status(code), U8("Message"),
+                        U8("Failed to get the assembly loader of the .NET runtime.")};
+                }
+
+                return reinterpret_cast<load_assembly_and_get_function_pointer_ptr>(delegate);
+            }
+
+        private:
+            template <typename T>
+            void load_function(const char* name, T& function) {
+                if (function = reinterpret_cast<T>(GetProcAddress(module_.get(), name)); function == nullptr) {
+                    throw formatted_runtime_error{
+                        U8("Function"), name, U8("Message"), U8("Failed to load the function from hostfxr.")};
+                }
+            }
+
+            unique_module module_;
+            hostfxr_initialize_for_runtime_config_ptr initialize_;
+            hostfxr_get_runtime_delegate_ptr get_runtime_delegate_;
+            hostfxr_close_ptr close_;
+        };
+
+        const dotnet_host& get_dotnet_host(const service_config& config) {
+            [[maybe_unused]] ES_KEEP_ALIVE static const dotnet_host host{config};
+
+            return host;
+        }
+
+        // Calls the [UnmanagedCallersOnly] static methods directly through function pointers, without COM.
+        class dotnet_service_worker {
+        public:
+            explicit dotnet_service_worker(service_config config)
+                : config_{std::move(config)}, run_{}, on_stop_{}, resolved_in_{}, reported_{} {
+                if (config_.context.empty()) {
+                    throw formatted_runtime_error{U8("Assembly"), config_.context, U8("Message"),
+                        U8("The context must be the path of a .NET assembly.")};
+                }
+
+                const auto dotnet    = config_.dotnet.value_or(service_config::dotnet_config{});
+                const auto& defaults = service_config::defaults().dotnet;
+
+                if (!dotnet.type) {
+                    throw formatted_runtime_error{U8("The type of the .NET worker must be set.")};
+                }
+
+                const auto started_at = std::chrono::steady_clock::now();
+                const std::filesystem::path assembly{to_u8string(config_.context)};
+                auto runtime_config = std::filesystem::path{assembly}.replace_extension(u8".runtimeconfig.json");
+
+                if (dotnet.runtime_config) {
+                    runtime_config = std::filesystem::path{to_u8string(*dotnet.runtime_config)};
+                }
+
+                const auto load = get_dotnet_host(config_).get_loader(runtime_config);
+
+                run_     = reinterpret_cast<dotnet_run_ptr>(get_function(
+                    load, assembly, *dotnet.type, dotnet.run_method.value_or(defaults.run_method)));
+                on_stop_ = reinterpret_cast<dotnet_on_stop_ptr>(get_function(
+                    load, assembly, *dotnet.type, dotnet.stop_method.value_or(defaults.stop_method)));
+
+                resolved_in_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - started_at);
+            }
+
+            dotnet_service_worker(dotnet_service_worker&&) noexcept = default;
+
+            dotnet_service_worker& operator=(dotnet_service_worker&&) noexcept = default;
+
+            [[nodiscard]] const service_config& config() const noexcept {
+                return config_;
+            }
+
+            // The methods are resolved along with the worker, before the logger of its service is known.
+            [[maybe_unused]] void attach(const std::shared_ptr<worker_context>& context) {
+                if (!std::exchange(reported_, true)) {
+                    context->logger()->info(U8("The .NET methods have been resolved in {} ms."), resolved_in_.count());
+                }
+            }
+
+            [[maybe_unused]] static void on_start() noexcept {}
+
+            [[maybe_unused]] void on_stop() const {
+                on_stop_();
+            }
+
+            [[maybe_unused]] void run() const {
+                const auto arguments = config_.arguments.value_or(std::vector<std::string>{});
+                auto argv            = arguments
+                          | std::views::transform([](const std::string& inner) { return inner.c_str(); })
+                          | std::ranges::to<std::vector<const char*>>();
+
+                run_(static_cast<std::int32_t>(argv.size()), argv.data());
+            }
+
+        private:
+            static void* get_function(load_assembly_and_get_function_pointer_ptr load,
+                const std::filesystem::path& assembly, std::string_view type, std::string_view method) {
+                void* function{};
+
+                if (const auto code = load(assembly.generic_wstring().c_str(), to_native_string(type).c_str(),
+                        to_native_string(method).c_str(), unmanaged_callers_only_method(), nullptr, &function);
+                    code < 0 || function == nullptr) {
+                    throw formatted_runtime_error{U8("Type"), type, U8("Method"), method, U8("Code"), to_status(code),
+                        U8("Message"), U8("Failed to get the [UnmanagedCallersOnly] method from the .NET assembly.")};
+                }
+
+                return function;
+            }
+
+            service_config config_;
+            dotnet_run_ptr run_;
+            dotnet_on_stop_ptr on_stop_;
+            std::chrono::milliseconds resolved_in_;
+            bool reported_;
+        };
+    } // namespace
+
+    abstract::service_worker make_dotnet_service_worker(service_config config) {
+        return abstract::service_worker{dotnet_service_worker{std::move(config)}};
+    }
+} // namespace essence::win
@@ -32,9 +32,11 @@ module;
 
 module refvalue.svchostify;
 import :abstract.service_worker;
+import :resource_limits;
 import :service_config;
 import :service_worker;
 import :util;
+import :worker_context;
 import essence.basic;
 import std;
 
@@ -42,9 +44,234 @@ namespace essence::win {
     namespace {
         using kernel_handle = unique_handle<&CloseHandle>;
 
+        constexpr std::string_view heartbeat_handle_variable{U8("SVCHOSTIFY_HEARTBEAT_HANDLE")};
+        constexpr std::string_view ready_handle_variable{U8("SVCHOSTIFY_READY_HANDLE")};
+        constexpr std::string_view listen_socket_variable{U8("SVCHOSTIFY_LISTEN_SOCKET")};
+        constexpr std::string_view replica_index_variable{U8("SVCHOSTIFY_REPLICA_INDEX")};
+        constexpr std::string_view activation_sockets_variable{U8("SVCHOSTIFY_ACTIVATION_SOCKETS")};
+
+        class proc_thread_attribute_list {
+        public:
+            explicit proc_thread_attribute_list(DWORD count) {
+                SIZE_T size{};
+
+                static_cast<void>(InitializeProcThreadAttributeList(nullptr, count, 0, &size));
+                buffer_ = std::make_unique_for_overwrite<std::byte[]>(size);
+
+                if (!InitializeProcThreadAttributeList(get(), count, 0, &size)) {
+                    throw formatted_runtime_error{U8("Message"), U8("Failed to initialize the attribute list."),
+                        U8("Internal"), get_last_error()};
+                }
+            }
+
+            proc_thread_attribute_list(const proc_thread_attribute_list&) = delete;
+
+            ~proc_thread_attribute_list() {
+                DeleteProcThreadAttributeList(get());
+            }
+
+            proc_thread_attribute_list& operator=(const proc_thread_attribute_list&) = delete;
+
+            void update(DWORD_PTR attribute, void* value, std::size_t size) const {
+                if (!UpdateProcThreadAttribute(get(), 0, attribute, value, size, nullptr, nullptr)) {
+                    throw formatted_runtime_error{U8("Message"), U8("Failed to update the attribute list."),
+                        U8("Internal"), get_last_error()};
+                }
+            }
+
+            [[nodiscard]] LPPROC_THREAD_ATTRIBUTE_LIST get() const noexcept {
+                return reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(buffer_.get());
+            }
+
+        private:
+            std::unique_ptr<std::byte[]> buffer_;
+        };
+
+        // The output of a chatty child is read in large chunks, so that a line rarely spans two reads.
+        constexpr std::size_t output_buffer_size = 64 * 1024;
+
+        std::pair<kernel_handle, kernel_handle> make_inheritable_pipe(DWORD size = 0) {
+            SECURITY_ATTRIBUTES attributes{
+                .nLength        = sizeof(SECURITY_ATTRIBUTES),
+                .bInheritHandle = TRUE,
+            };
+
+            HANDLE read{};
+            HANDLE write{};
+
+            if (!CreatePipe(&read, &write, &attributes, size)) {
+                throw formatted_runtime_error{
+                    U8("Message"), U8("Failed to create the pipe."), U8("Internal"), get_last_error()};
+            }
+
+            // Only the end for the child is inherited.
+            std::pair result{kernel_handle{read}, kernel_handle{write}};
+
+            SetHandleInformation(read, HANDLE_FLAG_INHERIT, 0);
+
+            return result;
+        }
+
+        // A pipe whose write end is inherited by the child, pumped by the host on its own thread until it breaks.
+        struct inherited_pipe {
+            kernel_handle read;
+            kernel_handle write;
+            std::function<void(const kernel_handle&)> pump;
+        };
+
+        // The child signals the host by writing anything to the pipe.
+        void pump_notifications(const kernel_handle& read, const std::function<void()>& handler) {
+            std::array<char, 64> buffer; // NOLINT(*-member-init)
+            const auto capacity = static_cast<DWORD>(buffer.size());
+
+            for (DWORD size{}; ReadFile(read.get(), buffer.data(), capacity, &size, nullptr) && size != 0;) {
+                handler();
+            }
+        }
+
+        // Forwards the output line by line, reusing one buffer so that nothing is allocated per line.
+        void pump_output(const kernel_handle& read, spdlog::logger& logger, spdlog::level::level_enum level) {
+            const auto buffer = std::make_unique_for_overwrite<char[]>(output_buffer_size);
+
+            const auto log_line = [&](std::string_view line) {
+                if (line.ends_with('\r')) {
+                    line.remove_suffix(1);
+                }
+
+                logger.log(level, line);
+            };
+
+            std::size_t pending{};
+
+            for (DWORD size{}; ReadFile(read.get(), buffer.get() + pending,
+                                   static_cast<DWORD>(output_buffer_size - pending), &size, nullptr)
+                               && size != 0;) {
+                std::string_view rest{buffer.get(), pending + size};
+
+                for (auto iter = rest.find('\n'); iter != std::string_view::npos; iter = rest.find('\n')) {
+                    log_line(rest.substr(0, iter));
+                    rest.remove_prefix(iter + 1);
+                }
+
+                // A line longer than the buffer is split.
+                if (rest.size() == output_buffer_size) {
+                    log_line(rest);
+                    rest = {};
+                }
+
+                pending = rest.size();
+                std::ranges::copy(rest, buffer.get());
+            }
+
+            if (pending != 0) {
+                log_line(std::string_view{buffer.get(), pending});
+            }
+        }
+
+        // An empty handle is returned on failure, since it is only used while stopping.
+        kernel_handle duplicate_handle(HANDLE handle) {
+            HANDLE result{};
+
+            if (!handle
+                || !DuplicateHandle(GetCurrentProcess(), handle, GetCurrentProcess(), &result, 0, FALSE,
+                    DUPLICATE_SAME_ACCESS)) {
+                return kernel_handle{};
+            }
+
+            return kernel_handle{result};
+        }
+
+        // The job kills the remaining processes of the tree once its last handle is closed.
+        kernel_handle make_process_tree_job() {
+            kernel_handle job{CreateJobObjectW(nullptr, nullptr)};
+
+            if (!job) {
+                throw formatted_runtime_error{
+                    U8("Message"), U8("Failed to create the job object."), U8("Internal"), get_last_error()};
+            }
+
+            JOBOBJECT_EXTENDED_LIMIT_INFORMATION info{
+                .BasicLimitInformation = {.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE},
+            };
+
+            if (!SetInformationJobObject(job.get(), JobObjectExtendedLimitInformation, &info, sizeof(info))) {
+                throw formatted_runtime_error{
+                    U8("Message"), U8("Failed to set the limits of the job object."), U8("Internal"), get_last_error()};
+            }
+
+            return job;
+        }
+
+        void close_windows(DWORD process_id) {
+            EnumWindows(
+                [](HWND window, LPARAM param) -> BOOL {
+                    if (DWORD owner{}; GetWindowThreadProcessId(window, &owner) && owner == static_cast<DWORD>(param)) {
+                        PostMessageW(window, WM_CLOSE, 0, 0);
+                    }
+
+                    return TRUE;
+                },
+                static_cast<LPARAM>(process_id));
+        }
+
+        // The cores the host may run on, handed out to the pinned replicas in turn.
+        std::vector<DWORD_PTR> get_available_cores() {
+            DWORD_PTR process_mask{};
+            DWORD_PTR system_mask{};
+            std::vector<DWORD_PTR> result;
+
+            if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+                for (std::size_t i = 0; i < std::numeric_limits<DWORD_PTR>::digits; i++) {
+                    if (const DWORD_PTR core = DWORD_PTR{1} << i; (process_mask & core) != 0) {
+                        result.emplace_back(core);
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        // One launched copy of the executable, with the job holding its process tree. The pumps are declared first,
+        // so that a destroyed child closes its job, and thus all pipes of its tree, before they are joined.
+        struct child_process {
+            std::size_t index{};
+            std::vector<std::jthread> pumps;
+            kernel_handle job;
+            kernel_handle thread;
+            kernel_handle process;
+        };
+
+        // A running replica being stopped, holding its own handles while on_stop() waits without the lock.
+        struct stopping_child {
+            std::size_t index{};
+            kernel_handle job;
+            kernel_handle process;
+        };
+
+        // The state shared by run() and a concurrent on_stop(), kept behind a pointer so that the worker stays
+        // movable.
+        struct replica_set {
+            replica_set() = default;
+            replica_set(const replica_set&) = delete;
+
+            ~replica_set() {
+                if (listener) {
+                    close_socket(*listener);
+                }
+            }
+
+            replica_set& operator=(const replica_set&) = delete;
+
+            std::mutex mutex;
+            std::vector<child_process> children;
+            std::vector<child_process> standby;
+            std::optional<std::uintptr_t> listener;
+        };
+
         class executable_service_worker {
         public:
-            explicit executable_service_worker(service_config config) : config_{std::move(config)} {
+            explicit executable_service_worker(service_config config)
+                : config_{std::move(config)}, replicas_{std::make_unique<replica_set>()} {
                 if (config_.context.empty()) {
                     throw formatted_runtime_error{U8("The context must be a non-empty executable path.")};
                 }
@@ -53,12 +280,20 @@ namespace essence::win {
                     throw formatted_runtime_error{U8("Executable Path"), config_.context, U8("Message"),
                         U8("The executable path must be a regular file.")};
                 }
+
+                // All replicas are awaited at once.
+                if (const auto count = replica_count(); count == 0 || count > MAXIMUM_WAIT_OBJECTS) {
+                    throw formatted_runtime_error{U8("Replicas"), count, U8("Lower Bound"), 1, U8("Upper Bound"),
+                        MAXIMUM_WAIT_OBJECTS, U8("Message"), U8("The replica count was out of range.")};
+                }
             }
 
             executable_service_worker(executable_service_worker&&) noexcept = default;
 
             ~executable_service_worker() {
-                on_stop();
+                if (replicas_) {
+                    on_stop();
+                }
             }
 
             executable_service_worker& operator=(executable_service_worker&&) noexcept = default;
@@ -67,43 +302,418 @@ namespace essence::win {
                 return config_;
             }
 
+            [[maybe_unused]] void attach(const std::shared_ptr<worker_context>& context) {
+                context_ = context;
+            }
+
+            // Spawns the children of a standby suspended, so that the next start only has to resume them. Dropping
+            // the standby closes their jobs and kills them.
+            [[maybe_unused]] void prepare() {
+                std::vector<child_process> children;
+
+                for (std::size_t i = 0; i < replica_count(); i++) {
+                    children.emplace_back(launch(i, true));
+                }
+
+                std::scoped_lock lock{replicas_->mutex};
+
+                std::swap(replicas_->standby, children);
+            }
+
             [[maybe_unused]] void on_start() {
-                STARTUPINFOW si{.cb = sizeof(STARTUPINFOW)};
+                // The socket outlives restarts, so that pending connections are kept in the backlog.
+                if (const auto port = config_.replicas ? config_.replicas->listen_port : std::nullopt;
+                    port && !replicas_->listener) {
+                    replicas_->listener = make_listener(*port);
+                }
+
+                std::vector<child_process> children;
+                {
+                    std::scoped_lock lock{replicas_->mutex};
+
+                    std::swap(replicas_->standby, children);
+                }
+
+                if (children.empty()) {
+                    for (std::size_t i = 0; i < replica_count(); i++) {
+                        children.emplace_back(launch(i));
+                    }
+                } else {
+                    for (auto&& item : children) {
+                        ResumeThread(item.thread.get());
+                    }
+                }
+
+                // Destroying the children of a previous run also kills what is left of their trees.
+                std::scoped_lock lock{replicas_->mutex};
+
+                std::swap(replicas_->children, children);
+            }
+
+            // Signals the children, and kills the whole trees of those that do not exit within the kill timeout.
+            void on_stop() const {
+                const auto signal     = get_stop_signal();
+                const auto started_at = std::chrono::steady_clock::now();
+                const std::chrono::milliseconds kill_timeout{
+                    config_.stop.value_or(service_config::stop_config{})
+                        .kill_timeout.value_or(service_config::defaults().stop.kill_timeout)};
+
+                // The handles are duplicated, so that the lock is not held while waiting and a respawned replica
+                // never closes them underneath.
+                std::vector<stopping_child> running;
+                {
+                    std::scoped_lock lock{replicas_->mutex};
+
+                    for (auto&& item : replicas_->children) {
+                        if (item.process && WaitForSingleObject(item.process.get(), 0) != WAIT_OBJECT_0) {
+                            send_stop_signal(item, signal);
+                            running.emplace_back(stopping_child{
+                                .index   = item.index,
+                                .job     = duplicate_handle(item.job.get()),
+                                .process = duplicate_handle(item.process.get()),
+                            });
+                        }
+                    }
+                }
+
+                for (auto&& item : running) {
+                    const auto remaining = std::max(std::chrono::milliseconds::zero(),
+                        kill_timeout
+                            - std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() - started_at));
+                    const auto timeout = static_cast<DWORD>(remaining.count());
+                    const auto killed  = signal == stop_signal::terminate
+                                     || WaitForSingleObject(item.process.get(), timeout) != WAIT_OBJECT_0;
+
+                    if (killed) {
+                        TerminateJobObject(item.job.get(), ERROR_PROCESS_ABORTED);
+                        WaitForSingleObject(item.process.get(), static_cast<DWORD>(kill_timeout.count()));
+                    }
+
+                    if (const auto logger = get_logger()) {
+                        const auto elapsed   = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - started_at);
+                        const auto exit_code = get_exit_code(item.process.get());
+
+                        if (killed) {
+                            logger->warn(U8("The process tree of replica {} was killed {} ms after the stop request, "
+                                            "exit code: {}."),
+                                item.index, elapsed.count(), exit_code);
+                        } else {
+                            logger->info(U8("The child process of replica {} stopped {} ms after the stop request, "
+                                            "exit code: {}."),
+                                item.index, elapsed.count(), exit_code);
+                        }
+                    }
+                }
+            }
+
+            // Waits for all replicas, respawning those that exit on their own according to the supervisor policy.
+            // The handles are kept until the next start, so that a concurrent stop never sees them closed.
+            [[maybe_unused]] void run() {
+                std::vector<std::deque<std::chrono::steady_clock::time_point>> respawns(replica_count());
+
+                for (;;) {
+                    std::vector<HANDLE> handles;
+                    std::vector<std::size_t> indices;
+                    {
+                        std::scoped_lock lock{replicas_->mutex};
+
+                        for (auto&& item : replicas_->children) {
+                            if (WaitForSingleObject(item.process.get(), 0) != WAIT_OBJECT_0) {
+                                handles.emplace_back(item.process.get());
+                                indices.emplace_back(item.index);
+                            }
+                        }
+                    }
+
+                    if (handles.empty()) {
+                        return;
+                    }
+
+                    const auto result = WaitForMultipleObjects(
+                        static_cast<DWORD>(handles.size()), handles.data(), FALSE, INFINITE);
+
+                    if (result >= WAIT_OBJECT_0 + handles.size()) {
+                        return;
+                    }
+
+                    const auto index = indices[result - WAIT_OBJECT_0];
+                    DWORD exit_code{};
+
+                    GetExitCodeProcess(handles[result - WAIT_OBJECT_0], &exit_code);
+
+                    if (const auto logger = get_logger()) {
+                        logger->info(U8("The child process of replica {} has exited with code {}."), index, exit_code);
+                    }
+
+                    if (should_respawn(exit_code, respawns[index])) {
+                        respawn(index);
+                    }
+                }
+            }
+
+        private:
+            [[nodiscard]] std::size_t replica_count() const noexcept {
+                return config_.replicas ? config_.replicas->count : 1U;
+            }
+
+            // The legacy option keeps its meaning unless a signal is configured explicitly.
+            [[nodiscard]] stop_signal get_stop_signal() const {
+                if (config_.stop && config_.stop->signal) {
+                    return *config_.stop->signal;
+                }
+
+                return config_.post_quit_message.value_or(false) ? stop_signal::quit_message
+                                                                 : service_config::defaults().stop.signal;
+            }
+
+            [[nodiscard]] std::shared_ptr<spdlog::logger> get_logger() const {
+                return context_ ? context_->logger() : nullptr;
+            }
+
+            // A single replica is left to the supervisor of the host, which restarts the whole worker instead.
+            [[nodiscard]] bool should_respawn(
+                DWORD exit_code, std::deque<std::chrono::steady_clock::time_point>& respawns) const {
+                const auto& defaults  = service_config::defaults().supervisor;
+                const auto supervisor = config_.supervisor.value_or(service_config::supervisor_config{});
+                const auto policy     = supervisor.policy.value_or(defaults.policy);
+
+                if (replica_count() == 1 || (context_ && context_->stop_requested()) || policy == restart_policy::never
+                    || (policy == restart_policy::on_failure && exit_code == 0)) {
+                    return false;
+                }
+
+                const auto now = std::chrono::steady_clock::now();
+                const std::chrono::milliseconds window{supervisor.restart_window.value_or(defaults.restart_window)};
+
+                while (!respawns.empty() && now - respawns.front() > window) {
+                    respawns.pop_front();
+                }
+
+                if (respawns.size() >= supervisor.max_restarts.value_or(defaults.max_restarts)) {
+                    if (const auto logger = get_logger()) {
+                        logger->error(U8("The replica has exited {} times within {} ms and will not be respawned."),
+                            respawns.size(), window.count());
+                    }
+
+                    return false;
+                }
+
+                respawns.emplace_back(now);
+
+                return true;
+            }
+
+            void respawn(std::size_t index) {
+                const std::chrono::milliseconds delay{
+                    config_.supervisor.value_or(service_config::supervisor_config{})
+                        .initial_backoff.value_or(service_config::defaults().supervisor.initial_backoff)};
+
+                // Gives up once a stop is requested during the delay.
+                if (context_ && context_->wait_for_stop(delay)) {
+                    return;
+                }
+
+                auto child = launch(index);
+
+                std::scoped_lock lock{replicas_->mutex};
+
+                std::swap(replicas_->children[index], child);
+            }
+
+            [[nodiscard]] std::optional<DWORD_PTR> get_replica_core(std::size_t index) const {
+                if (!config_.replicas || !config_.replicas->pin_cores.value_or(false)) {
+                    return std::nullopt;
+                }
+
+                // Pinned cores stay within the affinity of the job.
+                const auto affinity = config_.resources ? get_effective_affinity(*config_.resources) : ~DWORD_PTR{};
+                const auto cores = get_available_cores()
+                                 | std::views::filter([&](DWORD_PTR inner) { return (inner & affinity) != 0; })
+                                 | std::ranges::to<std::vector>();
+
+                if (!cores.empty()) {
+                    return cores[index % cores.size()];
+                }
+
+                return std::nullopt;
+            }
+
+            [[nodiscard]] child_process launch(std::size_t index, bool suspended = false) const {
+                const auto core = get_replica_core(index);
+                child_process child{.index = index};
+                std::vector<inherited_pipe> pipes;
+                std::vector<HANDLE> inherited_handles;
+                std::vector<std::pair<std::string, std::string>> variables;
+
+                const auto add_pipe = [&](DWORD size, std::function<void(const kernel_handle&)> pump) {
+                    auto [read, write] = make_inheritable_pipe(size);
+                    const auto handle  = write.get();
+
+                    inherited_handles.emplace_back(handle);
+                    pipes.emplace_back(std::move(read), std::move(write), std::move(pump));
+
+                    return handle;
+                };
+
+                const auto add_channel = [&](std::string_view variable, std::function<void()> handler) {
+                    const auto handle = add_pipe(0, [handler = std::move(handler)](const kernel_handle& read) {
+                        pump_notifications(read, handler);
+                    });
+
+                    variables.emplace_back(variable, std::to_string(reinterpret_cast<std::uintptr_t>(handle)));
+                };
+
+                const auto add_output = [&](spdlog::level::level_enum level) {
+                    return add_pipe(static_cast<DWORD>(output_buffer_size),
+                        [logger = context_->logger(), level](const kernel_handle& read) {
+                            pump_output(read, *logger, level);
+                        });
+                };
+
+                STARTUPINFOEXW si{
+                    .StartupInfo = {.cb = sizeof(STARTUPINFOEXW)},
+                };
+
+                if (context_) {
+                    add_channel(heartbeat_handle_variable, [context = context_] { context->beat(); });
+
+                    if (config_.readiness && config_.readiness->probe == readiness_probe::notify) {
+                        add_channel(ready_handle_variable, [context = context_] { context->notify_ready(); });
+                    }
+
+                    // Captures what the child prints into the service logger, like the stdio of in-process workers.
+                    if (config_.capture_output.value_or(service_config::defaults().capture_output)) {
+                        si.StartupInfo.dwFlags    = STARTF_USESTDHANDLES;
+                        si.StartupInfo.hStdOutput = add_output(spdlog::level::info);
+                        si.StartupInfo.hStdError  = add_output(spdlog::level::err);
+                    }
+                }
+
+                if (const auto listener = replicas_->listener) {
+                    inherited_handles.emplace_back(reinterpret_cast<HANDLE>(*listener));
+                    variables.emplace_back(listen_socket_variable, std::to_string(*listener));
+                }
+
+                if (context_ && !context_->listen_sockets().empty()) {
+                    std::string value;
+
+                    for (auto&& item : context_->listen_sockets()) {
+                        inherited_handles.emplace_back(reinterpret_cast<HANDLE>(item));
+                        value.append(value.empty() ? U8("") : U8(",")).append(std::to_string(item));
+                    }
+
+                    variables.emplace_back(activation_sockets_variable, std::move(value));
+                }
+
+                if (config_.replicas) {
+                    variables.emplace_back(replica_index_variable, std::to_string(index));
+                }
+
+                auto environment = make_environment_block(variables);
+                const proc_thread_attribute_list attributes{2};
+
+                if (!inherited_handles.empty()) {
+                    attributes.update(PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited_handles.data(),
+                        inherited_handles.size() * sizeof(HANDLE));
+                    si.lpAttributeList = attributes.get();
+                }
+
+                // The preferred node is where the memory of the child is allocated before its threads run anywhere,
+                // while the job keeps them on the processors of the node.
+                auto numa_node = config_.resources ? config_.resources->numa_node : std::nullopt;
+
+                if (numa_node) {
+                    attributes.update(PROC_THREAD_ATTRIBUTE_PREFERRED_NODE, &*numa_node, sizeof(*numa_node));
+                    si.lpAttributeList = attributes.get();
+                }
+
+                // Ctrl-Break only reaches a process group attached to the console of the host.
+                const DWORD console_flag =
+                    get_stop_signal() == stop_signal::ctrl_break ? CREATE_NEW_PROCESS_GROUP : CREATE_NEW_CONSOLE;
+                const DWORD creation_flags =
+                    console_flag | CREATE_SUSPENDED | CREATE_UNICODE_ENVIRONMENT | EXTENDED_STARTUPINFO_PRESENT;
+
+                child.job = make_process_tree_job();
+
+                if (config_.resources) {
+                    apply_job_limits(child.job.get(), *config_.resources);
+                }
+
                 PROCESS_INFORMATION pi{};
 
                 if (CreateProcessW(to_native_string(config_.context).c_str(),
                         config_.arguments ? make_command_line(*config_.arguments).data() : nullptr, nullptr, nullptr,
-                        FALSE, CREATE_NEW_CONSOLE, nullptr, nullptr, &si, &pi)) {
-                    wrapped_thread_.reset(pi.hThread);
-                    wrapped_process_.reset(pi.hProcess);
+                        !inherited_handles.empty(), creation_flags, environment.data(), nullptr, &si.StartupInfo,
+                        &pi)) {
+                    child.thread.reset(pi.hThread);
+                    child.process.reset(pi.hProcess);
                 } else {
                     throw formatted_runtime_error{U8("Failed to create the process.")};
                 }
-            }
 
-            void on_stop() const {
-                if (wrapped_process_) {
-                    if (config_.post_quit_message.value_or(false)) {
-                        PostThreadMessageW(GetThreadId(wrapped_thread_.get()), WM_QUIT, 0U, 0);
-                    } else {
-                        TerminateProcess(wrapped_process_.get(), 0U);
+                // The child is assigned before it runs, so that all its descendants belong to the job as well.
+                if (!AssignProcessToJobObject(child.job.get(), child.process.get())
+                    || (core && !SetProcessAffinityMask(child.process.get(), *core))) {
+                    TerminateProcess(child.process.get(), ERROR_PROCESS_ABORTED);
+
+                    throw formatted_runtime_error{U8("Replica"), index, U8("Message"),
+                        U8("Failed to set up the child process."), U8("Internal"), get_last_error()};
+                }
+
+                if (!suspended) {
+                    ResumeThread(child.thread.get());
+                }
+
+                if (const auto logger = get_logger(); logger && config_.resources) {
+                    logger->info(
+                        U8("Effective limits of replica {}: {}"), index, describe_job_limits(child.job.get()));
+
+                    // A job has no I/O priority limit, only a process may lower its own.
+                    if (config_.resources->io_priority == io_priority_level::very_low) {
+                        logger->warn("The I/O priority is not applied to child processes.");
                     }
                 }
+
+                // Closes the copies of the host, so that the pipes break once the child exits.
+                for (auto&& [read, write, pump] : pipes) {
+                    write.reset();
+                    child.pumps.emplace_back([read = std::move(read), pump = std::move(pump)] { pump(read); });
+                }
+
+                return child;
             }
 
-            [[maybe_unused]] void run() {
-                if (wrapped_process_) {
-                    WaitForSingleObject(wrapped_process_.get(), INFINITE);
+            static void send_stop_signal(const child_process& child, stop_signal signal) {
+                const auto process_id = GetProcessId(child.process.get());
+
+                switch (signal) {
+                case stop_signal::ctrl_break:
+                    GenerateConsoleCtrlEvent(CTRL_BREAK_EVENT, process_id);
+                    break;
+                case stop_signal::close_window:
+                    close_windows(process_id);
+                    break;
+                case stop_signal::quit_message:
+                    PostThreadMessageW(GetThreadId(child.thread.get()), WM_QUIT, 0U, 0);
+                    break;
+                default:
+                    break;
                 }
+            }
 
-                wrapped_thread_.reset();
-                wrapped_process_.reset();
+            static DWORD get_exit_code(HANDLE process) {
+                DWORD exit_code{};
+
+                GetExitCodeProcess(process, &exit_code);
+
+                return exit_code;
             }
 
-        private:
             service_config config_;
-            kernel_handle wrapped_thread_;
-            kernel_handle wrapped_process_;
+            std::shared_ptr<worker_context> context_;
+            std::unique_ptr<replica_set> replicas_;
         };
     } // namespace
 
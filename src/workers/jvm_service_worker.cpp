@@ -35,11 +35,16 @@ module;
 
 module refvalue.svchostify;
 import :abstract.service_worker;
+import :cds_archive;
+import :jvm_options;
 import :service_config;
 import :service_worker;
+import :spsc_ring;
 import :util;
+import :worker_context;
 import essence.basic;
 import essence.jni;
+import essence.serialization;
 import std;
 
 using namespace essence::jni;
@@ -50,31 +55,330 @@ namespace essence::win {
 
         std::atomic_int32_t jvm_class_key{1};
 
+        constexpr std::chrono::milliseconds channel_poll_interval{5};
+
+        spdlog::level::level_enum to_log_level(jint level) noexcept {
+            return static_cast<spdlog::level::level_enum>(
+                std::clamp<jint>(level, spdlog::level::trace, spdlog::level::critical));
+        }
+
+        // A line printed through a PrintStream ends with its line separator, which the logger adds by itself.
+        std::string_view trim_line(std::string_view message) noexcept {
+            while (message.ends_with(U8('\n')) || message.ends_with(U8('\r'))) {
+                message.remove_suffix(1);
+            }
+
+            return message;
+        }
+
+        // Two rings in one region of host memory exposed to the Java code as a direct ByteBuffer, the commands to the
+        // Java code first and then the events from it, so that no JNI call or Java object is needed per message. The
+        // events are drained by a thread of the host, started once the Java code asks for the ByteBuffer.
+        class host_channel {
+        public:
+            enum class command : std::uint32_t {
+                stop = 1,
+            };
+
+            enum class event : std::uint32_t {
+                heartbeat = 1,
+                ready,
+                counter,
+                log,
+            };
+
+            explicit host_channel(std::size_t capacity)
+                : memory_{allocate(spsc_ring::size_of(capacity) * 2)}, commands_{memory_.get(), capacity},
+                  events_{memory_.get() + spsc_ring::size_of(capacity), capacity} {}
+
+            void set_context(std::weak_ptr<worker_context> context) {
+                std::scoped_lock lock{mutex_};
+
+                context_ = std::move(context);
+            }
+
+            // Returns a new direct ByteBuffer over the whole region.
+            jobject open(JNIEnv* env) {
+                std::call_once(started_, [this] {
+                    drainer_ = std::jthread{[this](std::stop_token token) { drain_events(token); }};
+                });
+
+                return env->NewDirectByteBuffer(memory_.get(), static_cast<jlong>(memory_.get_deleter().size));
+            }
+
+            // Returns false if the Java code does not keep up with the commands.
+            bool post(command code) {
+                std::scoped_lock lock{mutex_};
+
+                return commands_.push(std::to_underlying(code), {});
+            }
+
+        private:
+            struct region_deleter {
+                std::size_t size{};
+
+                void operator()(std::byte* memory) const noexcept {
+                    VirtualFree(memory, 0, MEM_RELEASE);
+                }
+            };
+
+            using unique_region = std::unique_ptr<std::byte, region_deleter>;
+
+            // Page-aligned and zeroed, as the positions are accessed as 64-bit atomics on both sides.
+            static unique_region allocate(std::size_t size) {
+                if (const auto memory = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE)) {
+                    return unique_region{static_cast<std::byte*>(memory), region_deleter{size}};
+                }
+
+                throw formatted_runtime_error{U8("Size"), size, U8("Message"),
+                    U8("Failed to allocate the channel to the Java code."), U8("Internal"), get_last_error()};
+            }
+
+            void drain_events(std::stop_token token) {
+                while (!token.stop_requested()) {
+                    std::shared_ptr<worker_context> context;
+
+                    {
+                        std::scoped_lock lock{mutex_};
+
+                        context = context_.lock();
+                    }
+
+                    try {
+                        if (events_.drain([&](std::uint32_t type, std::span<const std::byte> payload) {
+                                if (context) {
+                                    dispatch(*context, type, payload);
+                                }
+                            }) != 0) {
+                            continue;
+                        }
+                    } catch (const std::exception& ex) {
+                        if (context && context->logger()) {
+                            context->logger()->error(
+                                U8("Failed to handle an event from the Java code: {}"), ex.what());
+                        }
+                    }
+
+                    std::this_thread::sleep_for(channel_poll_interval);
+                }
+            }
+
+            // A counter event carries a 64-bit delta and a UTF-8 name, and a log event a 32-bit level and UTF-8 bytes.
+            static void dispatch(worker_context& context, std::uint32_t type, std::span<const std::byte> payload) {
+                const auto text = [&](std::size_t offset) {
+                    return std::string_view{reinterpret_cast<const char*>(payload.data()) + offset,
+                        payload.size() - offset};
+                };
+
+                switch (static_cast<event>(type)) {
+                case event::heartbeat:
+                    context.beat();
+                    break;
+                case event::ready:
+                    context.notify_ready();
+                    break;
+                case event::counter:
+                    if (std::int64_t delta{}; payload.size() > sizeof(delta)) {
+                        std::memcpy(&delta, payload.data(), sizeof(delta));
+                        context.add_counter(text(sizeof(delta)), delta);
+                    }
+
+                    break;
+                case event::log:
+                    if (std::int32_t level{}; payload.size() >= sizeof(level) && context.logger()) {
+                        std::memcpy(&level, payload.data(), sizeof(level));
+                        context.logger()->log(to_log_level(level), trim_line(text(sizeof(level))));
+                    }
+
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            unique_region memory_;
+            spsc_ring commands_;
+            spsc_ring events_;
+            std::mutex mutex_;
+            std::weak_ptr<worker_context> context_;
+            std::once_flag started_;
+            std::jthread drainer_;
+        };
+
+        struct global_ref_deleter {
+            void operator()(jobject ref) const noexcept {
+                jvm::instance().ensure_env()->DeleteGlobalRef(ref);
+            }
+        };
+
+        // Maps the entry classes to the contexts and the channels of their workers, for the natives registered on them.
+        // An entry is removed by the destructor of its worker, and keeps the entry class alive until then.
+        struct native_target {
+            std::shared_ptr<std::remove_pointer_t<jclass>> entry_class;
+            std::weak_ptr<worker_context> context;
+            std::shared_ptr<host_channel> channel;
+        };
+
+        std::mutex native_mutex;
+        std::vector<native_target> native_targets;
+
+        native_target find_target(JNIEnv* env, jclass caller) {
+            std::scoped_lock lock{native_mutex};
+
+            for (auto&& item : native_targets) {
+                if (env->IsSameObject(item.entry_class.get(), caller)) {
+                    return item;
+                }
+            }
+
+            return {};
+        }
+
+        std::shared_ptr<worker_context> find_context(JNIEnv* env, jclass caller) {
+            return find_target(env, caller).context.lock();
+        }
+
+        void JNICALL java_heartbeat(JNIEnv* env, jclass caller) {
+            if (const auto context = find_context(env, caller)) {
+                context->beat();
+            }
+        }
+
+        void JNICALL java_notify_ready(JNIEnv* env, jclass caller) {
+            if (const auto context = find_context(env, caller)) {
+                context->notify_ready();
+            }
+        }
+
+        // Logs the UTF-8 bytes directly instead of going through the redirected stdio. The bytes are copied out
+        // rather than pinned, so that a slow sink does not hold up the garbage collector.
+        void JNICALL java_log(JNIEnv* env, jclass caller, jint level, jbyteArray message) {
+            thread_local std::string buffer;
+
+            const auto context = find_context(env, caller);
+
+            if (!context || message == nullptr) {
+                return;
+            }
+
+            buffer.resize(static_cast<std::size_t>(env->GetArrayLength(message)));
+            env->GetByteArrayRegion(
+                message, 0, static_cast<jsize>(buffer.size()), reinterpret_cast<jbyte*>(buffer.data()));
+            context->logger()->log(to_log_level(level), trim_line(buffer));
+        }
+
+        // Logs the UTF-8 bytes of a direct ByteBuffer in place.
+        void JNICALL java_log_buffer(JNIEnv* env, jclass caller, jint level, jobject message, jint size) {
+            const auto context = find_context(env, caller);
+
+            if (!context || message == nullptr) {
+                return;
+            }
+
+            const auto data     = static_cast<const char*>(env->GetDirectBufferAddress(message));
+            const auto capacity = env->GetDirectBufferCapacity(message);
+
+            if (data == nullptr || size < 0 || size > capacity) {
+                return;
+            }
+
+            context->logger()->log(to_log_level(level), trim_line({data, static_cast<std::size_t>(size)}));
+        }
+
+        jobject JNICALL java_channel(JNIEnv* env, jclass caller) {
+            const auto target = find_target(env, caller);
+
+            return target.channel ? target.channel->open(env) : nullptr;
+        }
+
+        // The optional natives of the entry class, bound only if declared.
+        const std::array host_natives{
+            JNINativeMethod{
+                .name      = const_cast<char*>(U8("heartbeat")),
+                .signature = const_cast<char*>(U8("()V")),
+                .fnPtr     = reinterpret_cast<void*>(&java_heartbeat),
+            },
+            JNINativeMethod{
+                .name      = const_cast<char*>(U8("notifyReady")),
+                .signature = const_cast<char*>(U8("()V")),
+                .fnPtr     = reinterpret_cast<void*>(&java_notify_ready),
+            },
+            JNINativeMethod{
+                .name      = const_cast<char*>(U8("log")),
+                .signature = const_cast<char*>(U8("(I[B)V")),
+                .fnPtr     = reinterpret_cast<void*>(&java_log),
+            },
+            JNINativeMethod{
+                .name      = const_cast<char*>(U8("log")),
+                .signature = const_cast<char*>(U8("(ILjava/nio/ByteBuffer;I)V")),
+                .fnPtr     = reinterpret_cast<void*>(&java_log_buffer),
+            },
+            JNINativeMethod{
+                .name      = const_cast<char*>(U8("channel")),
+                .signature = const_cast<char*>(U8("()Ljava/nio/ByteBuffer;")),
+                .fnPtr     = reinterpret_cast<void*>(&java_channel),
+            },
+        };
+
         class jvm_initializer {
         public:
-            jvm_initializer(std::string_view jdk_directory, std::string_view class_path) : create_java_vm_{} {
-                load_jvm(jdk_directory);
+            // The first worker creating the JVM decides its options, as there is only one JVM per process.
+            explicit jvm_initializer(const service_config& config)
+                : owner_{config.name}, created_size_{}, create_java_vm_{} {
+                const auto working_set = get_working_set_size();
+
+                load_jvm(*config.jdk_directory);
 
-                std::string option_str{U8("-Djava.class.path=")};
+                auto option_strings = make_jvm_options(config);
+
+                if (auto option = prepare_cds_archive(config)) {
+                    option_strings.emplace_back(std::move(*option));
+                }
+
+                auto options = option_strings | std::views::transform([](std::string& inner) {
+                    return JavaVMOption{.optionString = inner.data()};
+                }) | std::ranges::to<std::vector>();
 
                 JavaVM* vm{};
                 JNIEnv* env{};
-                JavaVMOption option{
-                    .optionString = option_str.append(class_path).data(),
-                };
-
                 JavaVMInitArgs args{
-                    .version            = JNI_VERSION_1_6,
-                    .nOptions           = 1,
-                    .options            = &option,
+                    .version            = get_jni_version(config),
+                    .nOptions           = static_cast<jint>(options.size()),
+                    .options            = options.data(),
                     .ignoreUnrecognized = JNI_FALSE,
                 };
 
-                if (create_java_vm_(&vm, reinterpret_cast<void**>(&env), &args) != JNI_OK) {
-                    throw formatted_runtime_error{U8("Failed to create Java VM.")};
+                options_ = json(option_strings).dump();
+
+                const auto started_at = std::chrono::steady_clock::now();
+
+                if (const auto code = create_java_vm_(&vm, reinterpret_cast<void**>(&env), &args); code != JNI_OK) {
+                    throw formatted_runtime_error{U8("JNI Version"), args.version, U8("Options"), options_, U8("Code"),
+                        code, U8("Message"), U8("Failed to create Java VM.")};
                 }
 
+                created_in_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - started_at);
+
                 jvm::instance().init(vm);
+                created_size_ = get_working_set_size() - working_set;
+            }
+
+            [[nodiscard]] const std::string& owner() const noexcept {
+                return owner_;
+            }
+
+            // The growth of the working set by loading and creating the JVM.
+            [[nodiscard]] std::size_t created_size() const noexcept {
+                return created_size_;
+            }
+
+            [[nodiscard]] const std::string& options() const noexcept {
+                return options_;
+            }
+
+            [[nodiscard]] std::chrono::milliseconds created_in() const noexcept {
+                return created_in_;
             }
 
         private:
@@ -106,6 +410,10 @@ namespace essence::win {
                 }
             }
 
+            std::string owner_;
+            std::string options_;
+            std::chrono::milliseconds created_in_{};
+            std::size_t created_size_;
             unique_module jvm_module_;
             unique_module awt_module_;
             decltype(&JNI_CreateJavaVM) create_java_vm_;
@@ -118,10 +426,309 @@ namespace essence::win {
             }
         }
 
+        // Passes the result of a JNI call through, throwing the pending Java exception if any.
+        template <typename T>
+        T checked(T result) {
+            handle_java_exception();
+
+            return result;
+        }
+
+        // There is only one JVM per process, shared by all jvm workers of a host group.
+        const jvm_initializer& get_shared_jvm(const service_config& config) {
+            [[maybe_unused]] ES_KEEP_ALIVE static const jvm_initializer jvm_init{config};
+
+            return jvm_init;
+        }
+
+        // Closes the URLClassLoader before releasing it, so that its JAR files are closed as well.
+        struct class_loader_deleter {
+            void operator()(jobject ref) const noexcept {
+                const auto env    = jvm::instance().ensure_env();
+                const auto loader = env->GetObjectClass(ref);
+
+                if (const auto close = env->GetMethodID(loader, U8("close"), U8("()V"))) {
+                    env->CallVoidMethod(ref, close);
+                }
+
+                env->ExceptionClear();
+                env->DeleteLocalRef(loader);
+                env->DeleteGlobalRef(ref);
+            }
+        };
+
+        using unique_global_ref   = std::unique_ptr<std::remove_pointer_t<jobject>, global_ref_deleter>;
+        using unique_class_loader = std::unique_ptr<std::remove_pointer_t<jobject>, class_loader_deleter>;
+
+        // Creates a URLClassLoader over the class path, whose parent is the platform class loader, so that nothing
+        // is shared with the class path of the JVM but the JDK itself.
+        unique_class_loader make_class_loader(std::string_view class_path) {
+            const auto env   = jvm::instance().ensure_env();
+            const auto paths = expand_class_path(class_path);
+
+            if (env->PushLocalFrame(static_cast<jint>(paths.size() * 4 + 16)) != JNI_OK) {
+                handle_java_exception();
+            }
+
+            const scope_exit frame_scope{[&] { env->PopLocalFrame(nullptr); }};
+
+            const auto file_class = checked(env->FindClass(U8("java/io/File")));
+            const auto uri_class  = checked(env->FindClass(U8("java/net/URI")));
+            const auto url_class  = checked(env->FindClass(U8("java/net/URL")));
+            const auto file_ctor  = checked(env->GetMethodID(file_class, U8("<init>"), U8("(Ljava/lang/String;)V")));
+            const auto to_uri     = checked(env->GetMethodID(file_class, U8("toURI"), U8("()Ljava/net/URI;")));
+            const auto to_url     = checked(env->GetMethodID(uri_class, U8("toURL"), U8("()Ljava/net/URL;")));
+            const auto urls = checked(env->NewObjectArray(static_cast<jsize>(paths.size()), url_class, nullptr));
+
+            for (jsize i = 0; auto&& item : paths) {
+                const auto path = checked(env->NewStringUTF(from_u8string(item.generic_u8string()).c_str()));
+                const auto file = checked(env->NewObject(file_class, file_ctor, path));
+                const auto uri  = checked(env->CallObjectMethod(file, to_uri));
+
+                env->SetObjectArrayElement(urls, i++, checked(env->CallObjectMethod(uri, to_url)));
+            }
+
+            // The platform class loader does not exist until Java 9, where the bootstrap class loader is used.
+            const auto base_class = checked(env->FindClass(U8("java/lang/ClassLoader")));
+            jobject parent{};
+
+            if (const auto get_platform = env->GetStaticMethodID(
+                    base_class, U8("getPlatformClassLoader"), U8("()Ljava/lang/ClassLoader;"))) {
+                parent = checked(env->CallStaticObjectMethod(base_class, get_platform));
+            } else {
+                env->ExceptionClear();
+            }
+
+            const auto loader_class = checked(env->FindClass(U8("java/net/URLClassLoader")));
+            const auto loader_ctor  = checked(
+                env->GetMethodID(loader_class, U8("<init>"), U8("([Ljava/net/URL;Ljava/lang/ClassLoader;)V")));
+
+            return unique_class_loader{
+                env->NewGlobalRef(checked(env->NewObject(loader_class, loader_ctor, urls, parent)))};
+        }
+
+        // Loads and initializes a class through the class loader, returning a global reference.
+        unique_global_ref load_class(jobject class_loader, std::string_view name) {
+            const auto env          = jvm::instance().ensure_env();
+            const auto loader_class = env->GetObjectClass(class_loader);
+            const auto load_method =
+                env->GetMethodID(loader_class, U8("loadClass"), U8("(Ljava/lang/String;)Ljava/lang/Class;"));
+
+            env->DeleteLocalRef(loader_class);
+            handle_java_exception();
+
+            const auto class_name = env->NewStringUTF(std::string{name}.c_str());
+            const auto result     = env->CallObjectMethod(class_loader, load_method, class_name);
+
+            env->DeleteLocalRef(class_name);
+            handle_java_exception();
+
+            const scope_exit result_scope{[&] { env->DeleteLocalRef(result); }};
+
+            return unique_global_ref{env->NewGlobalRef(result)};
+        }
+
+        // Returns null if the entry class does not declare the method.
+        jmethodID find_static_method(jclass target, const std::string& name, const char* signature) {
+            const auto env = jvm::instance().ensure_env();
+
+            if (const auto method = env->GetStaticMethodID(target, name.c_str(), signature)) {
+                return method;
+            }
+
+            env->ExceptionClear();
+
+            return nullptr;
+        }
+
+        struct jvm_collector_metrics {
+            enum class json_serialization {
+                camel_case,
+            };
+
+            std::string name;
+            std::int64_t count{};
+            std::int64_t time{};
+            std::int64_t count_delta{};
+            std::int64_t time_delta{};
+        };
+
+        // The sizes are in bytes and the times in milliseconds, with the deltas since the previous sample.
+        struct jvm_metrics {
+            enum class json_serialization {
+                camel_case,
+            };
+
+            std::int64_t heap_used{};
+            std::int64_t heap_committed{};
+            std::int64_t heap_max{};
+            std::int64_t non_heap_used{};
+            std::int64_t non_heap_committed{};
+            std::int32_t threads{};
+            std::int32_t daemon_threads{};
+            std::int32_t peak_threads{};
+            std::vector<jvm_collector_metrics> collectors;
+            std::int64_t sampling_time_us{};
+        };
+
+        // Samples the heap, the garbage collectors and the threads of the JVM through the platform MXBeans at an
+        // interval, as a JSON line of the service log. The beans and the methods are resolved once, so that a sample
+        // only takes a few JNI calls on a thread of its own.
+        class jvm_metrics_sampler {
+        public:
+            explicit jvm_metrics_sampler(std::chrono::milliseconds interval) : interval_{interval} {
+                const auto env           = jvm::instance().ensure_env();
+                const auto factory_class = checked(env->FindClass(U8("java/lang/management/ManagementFactory")));
+                const scope_exit factory_scope{[&] { env->DeleteLocalRef(factory_class); }};
+
+                const auto get_bean = [&](const char* name, const char* signature) {
+                    const auto method = checked(env->GetStaticMethodID(factory_class, name, signature));
+                    const auto bean   = checked(env->CallStaticObjectMethod(factory_class, method));
+                    const scope_exit bean_scope{[&] { env->DeleteLocalRef(bean); }};
+
+                    return unique_global_ref{env->NewGlobalRef(bean)};
+                };
+
+                const auto get_method = [&](const char* class_name, const char* name, const char* signature) {
+                    const auto target = checked(env->FindClass(class_name));
+                    const scope_exit target_scope{[&] { env->DeleteLocalRef(target); }};
+
+                    return checked(env->GetMethodID(target, name, signature));
+                };
+
+                memory_bean_     = get_bean(U8("getMemoryMXBean"), U8("()Ljava/lang/management/MemoryMXBean;"));
+                thread_bean_     = get_bean(U8("getThreadMXBean"), U8("()Ljava/lang/management/ThreadMXBean;"));
+                collector_beans_ = get_bean(U8("getGarbageCollectorMXBeans"), U8("()Ljava/util/List;"));
+
+                constexpr auto memory_bean     = U8("java/lang/management/MemoryMXBean");
+                constexpr auto memory_usage    = U8("java/lang/management/MemoryUsage");
+                constexpr auto usage_signature = U8("()Ljava/lang/management/MemoryUsage;");
+                constexpr auto thread_bean     = U8("java/lang/management/ThreadMXBean");
+                constexpr auto manager_bean    = U8("java/lang/management/MemoryManagerMXBean");
+                constexpr auto collector_bean  = U8("java/lang/management/GarbageCollectorMXBean");
+                constexpr auto list            = U8("java/util/List");
+
+                heap_usage_       = get_method(memory_bean, U8("getHeapMemoryUsage"), usage_signature);
+                non_heap_usage_   = get_method(memory_bean, U8("getNonHeapMemoryUsage"), usage_signature);
+                used_             = get_method(memory_usage, U8("getUsed"), U8("()J"));
+                committed_        = get_method(memory_usage, U8("getCommitted"), U8("()J"));
+                max_              = get_method(memory_usage, U8("getMax"), U8("()J"));
+                thread_count_     = get_method(thread_bean, U8("getThreadCount"), U8("()I"));
+                daemon_count_     = get_method(thread_bean, U8("getDaemonThreadCount"), U8("()I"));
+                peak_count_       = get_method(thread_bean, U8("getPeakThreadCount"), U8("()I"));
+                list_size_        = get_method(list, U8("size"), U8("()I"));
+                list_get_         = get_method(list, U8("get"), U8("(I)Ljava/lang/Object;"));
+                collector_name_   = get_method(manager_bean, U8("getName"), U8("()Ljava/lang/String;"));
+                collection_count_ = get_method(collector_bean, U8("getCollectionCount"), U8("()J"));
+                collection_time_  = get_method(collector_bean, U8("getCollectionTime"), U8("()J"));
+            }
+
+            void start(std::shared_ptr<spdlog::logger> logger) {
+                std::scoped_lock lock{mutex_};
+
+                if (!thread_.joinable()) {
+                    thread_ = std::jthread{[this, logger = std::move(logger)](std::stop_token token) {
+                        std::mutex wait_mutex;
+                        std::condition_variable_any condition;
+                        std::unique_lock wait_lock{wait_mutex};
+
+                        while (!condition.wait_for(
+                            wait_lock, token, interval_, [&] { return token.stop_requested(); })) {
+                            try {
+                                logger->info(U8("JVM metrics: {}"), json(sample()).dump());
+                            } catch (const std::exception& ex) {
+                                logger->warn(U8("Failed to sample the JVM metrics: {}"), ex.what());
+                            }
+                        }
+                    }};
+                }
+            }
+
+            void stop() {
+                std::scoped_lock lock{mutex_};
+
+                thread_ = std::jthread{};
+            }
+
+        private:
+            jvm_metrics sample() {
+                const auto env        = jvm::instance().ensure_env();
+                const auto started_at = std::chrono::steady_clock::now();
+
+                if (env->PushLocalFrame(32) != JNI_OK) {
+                    handle_java_exception();
+                }
+
+                const scope_exit frame_scope{[&] { env->PopLocalFrame(nullptr); }};
+
+                jvm_metrics result;
+
+                const auto heap     = checked(env->CallObjectMethod(memory_bean_.get(), heap_usage_));
+                const auto non_heap = checked(env->CallObjectMethod(memory_bean_.get(), non_heap_usage_));
+
+                result.heap_used          = checked(env->CallLongMethod(heap, used_));
+                result.heap_committed     = checked(env->CallLongMethod(heap, committed_));
+                result.heap_max           = checked(env->CallLongMethod(heap, max_));
+                result.non_heap_used      = checked(env->CallLongMethod(non_heap, used_));
+                result.non_heap_committed = checked(env->CallLongMethod(non_heap, committed_));
+                result.threads            = checked(env->CallIntMethod(thread_bean_.get(), thread_count_));
+                result.daemon_threads     = checked(env->CallIntMethod(thread_bean_.get(), daemon_count_));
+                result.peak_threads       = checked(env->CallIntMethod(thread_bean_.get(), peak_count_));
+
+                const auto collectors = checked(env->CallIntMethod(collector_beans_.get(), list_size_));
+
+                for (jint i = 0; i < collectors; i++) {
+                    const auto bean  = checked(env->CallObjectMethod(collector_beans_.get(), list_get_, i));
+                    const auto name  = static_cast<jstring>(checked(env->CallObjectMethod(bean, collector_name_)));
+                    const auto chars = env->GetStringUTFChars(name, nullptr);
+                    const scope_exit chars_scope{[&] { env->ReleaseStringUTFChars(name, chars); }};
+
+                    auto& item = result.collectors.emplace_back(jvm_collector_metrics{
+                        .name  = chars,
+                        .count = checked(env->CallLongMethod(bean, collection_count_)),
+                        .time  = checked(env->CallLongMethod(bean, collection_time_)),
+                    });
+
+                    auto& [last_count, last_time] = last_collections_[item.name];
+
+                    item.count_delta = item.count - std::exchange(last_count, item.count);
+                    item.time_delta  = item.time - std::exchange(last_time, item.time);
+                }
+
+                const auto elapsed = std::chrono::steady_clock::now() - started_at;
+
+                result.sampling_time_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+                return result;
+            }
+
+            std::chrono::milliseconds interval_;
+            unique_global_ref memory_bean_;
+            unique_global_ref thread_bean_;
+            unique_global_ref collector_beans_;
+            jmethodID heap_usage_{};
+            jmethodID non_heap_usage_{};
+            jmethodID used_{};
+            jmethodID committed_{};
+            jmethodID max_{};
+            jmethodID thread_count_{};
+            jmethodID daemon_count_{};
+            jmethodID peak_count_{};
+            jmethodID list_size_{};
+            jmethodID list_get_{};
+            jmethodID collector_name_{};
+            jmethodID collection_count_{};
+            jmethodID collection_time_{};
+            std::map<std::string, std::pair<std::int64_t, std::int64_t>> last_collections_;
+            std::mutex mutex_;
+            std::jthread thread_;
+        };
+
         class jvm_service_worker {
         public:
             explicit jvm_service_worker(service_config config)
-                : config_{std::move(config)}, method_run_{}, method_on_stop_{} {
+                : config_{std::move(config)}, entry_class_{}, method_run_{}, method_on_stop_{}, method_warmup_{},
+                  run_with_arguments_{}, joined_size_{}, jvm_reported_{}, logger_{spdlog::default_logger()} {
                 if (config_.context.empty()) {
                     throw formatted_runtime_error{U8("Class Path"), config_.context, U8("Message"),
                         U8("The context must be a non-empty CLASSPATH for JVM bootstrap.")};
@@ -136,47 +743,246 @@ namespace essence::win {
                         U8("JDK Directory"), config_.context, U8("Message"), U8("The JDK directory must exist.")};
                 }
 
-                const auto class_key = jvm_class_key.fetch_add(1, std::memory_order::acq_rel);
-                [[maybe_unused]] ES_KEEP_ALIVE static const jvm_initializer jvm_init{
-                    *config_.jdk_directory,
-                    config_.context,
-                };
+                const auto working_set  = get_working_set_size();
+                const auto& shared_jvm  = get_shared_jvm(config_);
+                const auto jvm_settings = config_.jvm.value_or(service_config::jvm_config{});
+                const auto& defaults    = service_config::defaults().jvm;
+                const auto entry_class  = jvm_settings.entry_class.value_or(defaults.entry_class);
 
-                // Makes Java method bindings.
-                class_svchost_broker_ = reflector::instance().add_class(class_key, U8("org/refvalue/SvcHostify"));
-                method_run_ =
-                    reflector::instance().add_static_method(class_key, {1, U8("run"), U8("([Ljava/lang/String;)V")});
+                if (jvm_settings.isolated.value_or(defaults.isolated)) {
+                    load_isolated(entry_class);
+                } else {
+                    load_shared(entry_class);
+                }
 
-                method_on_stop_ = reflector::instance().add_static_method(class_key, {2, U8("onStop"), U8("()V")});
+                bind_methods(entry_class, jvm_settings);
+                channel_ = std::make_shared<host_channel>(get_channel_capacity(config_));
+
+                if (jvm_settings.metrics_interval.value_or(0) != 0) {
+                    metrics_sampler_ = std::make_shared<jvm_metrics_sampler>(
+                        std::chrono::milliseconds{*jvm_settings.metrics_interval});
+                }
+
+                if (shared_jvm.owner() != config_.name) {
+                    joined_size_ = get_working_set_size() - working_set;
+                }
             }
 
             jvm_service_worker(jvm_service_worker&&) noexcept = default;
 
-            jvm_service_worker& operator=(jvm_service_worker&&) noexcept = default;
+            ~jvm_service_worker() {
+                if (!channel_) {
+                    return;
+                }
+
+                std::scoped_lock lock{native_mutex};
+
+                std::erase_if(native_targets, [&](const native_target& item) { return item.channel == channel_; });
+            }
 
             [[nodiscard]] const service_config& config() const noexcept {
                 return config_;
             }
 
-            [[maybe_unused]] static void on_start() noexcept {}
+            // Binds the 'static native void heartbeat()', 'static native void notifyReady()', 'static native void
+            // log(...)' and 'static native ByteBuffer channel()' methods if the entry class declares them.
+            [[maybe_unused]] void attach(const std::shared_ptr<worker_context>& context) {
+                logger_ = context->logger();
+
+                // The JVM is created or joined along with the worker, before the logger of its service is known.
+                if (!std::exchange(jvm_reported_, true)) {
+                    report_jvm();
+                }
+
+                const auto env = jvm::instance().ensure_env();
+                std::vector<JNINativeMethod> methods;
+
+                for (auto&& item : host_natives) {
+                    if (env->GetStaticMethodID(entry_class_, item.name, item.signature) != nullptr) {
+                        methods.emplace_back(item);
+                    } else {
+                        env->ExceptionClear();
+                    }
+                }
+
+                if (methods.empty()) {
+                    return;
+                }
+
+                if (env->RegisterNatives(entry_class_, methods.data(), static_cast<jint>(methods.size())) != JNI_OK) {
+                    handle_java_exception();
+                }
+
+                std::scoped_lock lock{native_mutex};
+
+                channel_->set_context(context);
+
+                // Attaching again, with the context of a later start, replaces the entry of the worker.
+                if (const auto iter = std::ranges::find(native_targets, channel_, &native_target::channel);
+                    iter != native_targets.end()) {
+                    iter->context = context;
+                } else {
+                    native_targets.emplace_back(
+                        std::shared_ptr<std::remove_pointer_t<jclass>>{
+                            static_cast<jclass>(env->NewGlobalRef(entry_class_)), global_ref_deleter{}},
+                        context, channel_);
+                }
+            }
+
+            // Warms up the JIT before the service is reported as running. The sampler is started by every start of the
+            // worker, including those by the supervisor, as every stop stops it.
+            [[maybe_unused]] void on_start() const {
+                if (metrics_sampler_) {
+                    metrics_sampler_->start(logger_);
+                }
+
+                if (method_warmup_ == nullptr) {
+                    return;
+                }
+
+                const auto started_at = std::chrono::steady_clock::now();
+
+                enter_class_loader();
+                jvm::instance().ensure_env()->CallStaticVoidMethod(entry_class_, method_warmup_);
+                handle_java_exception();
+
+                logger_->info(U8("The warm-up has completed in {} ms."),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started_at)
+                        .count());
+            }
 
             [[maybe_unused]] void on_stop() const {
-                jvm::instance().ensure_env()->CallStaticVoidMethod(class_svchost_broker_.get(), method_on_stop_);
+                if (metrics_sampler_) {
+                    metrics_sampler_->stop();
+                }
+
+                if (!channel_->post(host_channel::command::stop)) {
+                    logger_->warn(
+                        U8("The stop command could not be posted, as the channel to the Java code is full."));
+                }
+
+                enter_class_loader();
+                jvm::instance().ensure_env()->CallStaticVoidMethod(entry_class_, method_on_stop_);
                 handle_java_exception();
             }
 
             [[maybe_unused]] void run() const {
-                jvm::instance().ensure_env()->CallStaticVoidMethod(class_svchost_broker_.get(), method_run_,
-                    scoped::make_array(config_.arguments.value_or(std::vector<std::string>{})).get());
+                const auto env = jvm::instance().ensure_env();
+
+                enter_class_loader();
+
+                if (run_with_arguments_) {
+                    env->CallStaticVoidMethod(entry_class_, method_run_,
+                        scoped::make_array(config_.arguments.value_or(std::vector<std::string>{})).get());
+                } else {
+                    env->CallStaticVoidMethod(entry_class_, method_run_);
+                }
 
                 handle_java_exception();
             }
 
         private:
+            void report_jvm() const {
+                const auto& shared_jvm = get_shared_jvm(config_);
+
+                // Compares the starts with and without a CDS archive, and what joining the JVM of another service cost
+                // compared with creating one.
+                if (shared_jvm.owner() == config_.name) {
+                    logger_->info(U8("JVM options: {}"), shared_jvm.options());
+                    logger_->info(U8("The JVM has been created in {} ms."), shared_jvm.created_in().count());
+                } else {
+                    logger_->info(U8("Joined the JVM of {}, growing the working set by {} bytes, where creating the "
+                                     "JVM took {} bytes."),
+                        shared_jvm.owner(), joined_size_, shared_jvm.created_size());
+                }
+            }
+
+            // Looks the entry class up in the class path of the JVM.
+            void load_shared(std::string_view entry_class) {
+                const auto class_key = jvm_class_key.fetch_add(1, std::memory_order::acq_rel);
+                std::string class_name{entry_class};
+
+                std::ranges::replace(class_name, U8('.'), U8('/'));
+                class_svchost_broker_ = reflector::instance().add_class(class_key, class_name);
+                entry_class_          = class_svchost_broker_.get();
+            }
+
+            // Loads the entry class from the context by a class loader of its own.
+            void load_isolated(std::string_view entry_class) {
+                class_loader_   = make_class_loader(config_.context);
+                isolated_class_ = load_class(class_loader_.get(), entry_class);
+                entry_class_    = static_cast<jclass>(isolated_class_.get());
+            }
+
+            // Resolves the methods once, so that a missing one fails the creation of the worker.
+            void bind_methods(std::string_view entry_class, const service_config::jvm_config& jvm_settings) {
+                const auto& defaults   = service_config::defaults().jvm;
+                const auto run_method  = jvm_settings.run_method.value_or(defaults.run_method);
+                const auto stop_method = jvm_settings.stop_method.value_or(defaults.stop_method);
+                const auto require     = [&](const std::string& name, jmethodID method) {
+                    if (method == nullptr) {
+                        throw formatted_runtime_error{U8("Entry Class"), entry_class, U8("Method"), name, U8("Message"),
+                            U8("The entry class does not declare the static method.")};
+                    }
+
+                    return method;
+                };
+
+                method_run_         = find_static_method(entry_class_, run_method, U8("([Ljava/lang/String;)V"));
+                run_with_arguments_ = method_run_ != nullptr;
+
+                if (!run_with_arguments_) {
+                    method_run_ = require(run_method, find_static_method(entry_class_, run_method, U8("()V")));
+                }
+
+                method_on_stop_ = require(stop_method, find_static_method(entry_class_, stop_method, U8("()V")));
+
+                if (const auto& warmup = jvm_settings.warmup) {
+                    method_warmup_ = require(*warmup, find_static_method(entry_class_, *warmup, U8("()V")));
+                }
+            }
+
+            // Lets the Java code of an isolated worker find its resources through the context class loader.
+            void enter_class_loader() const {
+                if (!class_loader_) {
+                    return;
+                }
+
+                const auto env          = jvm::instance().ensure_env();
+                const auto thread_class = env->FindClass(U8("java/lang/Thread"));
+                const scope_exit thread_class_scope{[&] { env->DeleteLocalRef(thread_class); }};
+
+                handle_java_exception();
+
+                const auto current_thread =
+                    env->GetStaticMethodID(thread_class, U8("currentThread"), U8("()Ljava/lang/Thread;"));
+                const auto set_loader =
+                    env->GetMethodID(thread_class, U8("setContextClassLoader"), U8("(Ljava/lang/ClassLoader;)V"));
+
+                handle_java_exception();
+
+                const auto thread = env->CallStaticObjectMethod(thread_class, current_thread);
+                const scope_exit thread_scope{[&] { env->DeleteLocalRef(thread); }};
+
+                handle_java_exception();
+                env->CallVoidMethod(thread, set_loader, class_loader_.get());
+                handle_java_exception();
+            }
+
             service_config config_;
             global_ref_ex<jclass> class_svchost_broker_;
+            unique_class_loader class_loader_;
+            unique_global_ref isolated_class_;
+            jclass entry_class_;
             jmethodID method_run_;
             jmethodID method_on_stop_;
+            jmethodID method_warmup_;
+            bool run_with_arguments_;
+            std::shared_ptr<host_channel> channel_;
+            std::shared_ptr<jvm_metrics_sampler> metrics_sampler_;
+            std::size_t joined_size_;
+            bool jvm_reported_;
+            std::shared_ptr<spdlog::logger> logger_;
         };
     } // namespace
 
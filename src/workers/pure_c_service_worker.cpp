@@ -34,6 +34,7 @@ module refvalue.svchostify;
 import :abstract.service_worker;
 import :service_config;
 import :service_worker;
+import :worker_context;
 import essence.basic;
 import std;
 
@@ -41,8 +42,76 @@ namespace essence::win {
     namespace {
         using unique_module = unique_handle<&FreeLibrary>;
 
-        using refvalue_svchostify_run_ptr     = void (*)(std::size_t argc, const char* argv[]);
-        using refvalue_svchostify_on_stop_ptr = void (*)();
+        using refvalue_svchostify_run_ptr            = void (*)(std::size_t argc, const char* argv[]);
+        using refvalue_svchostify_on_stop_ptr        = void (*)();
+        using refvalue_svchostify_heartbeat_ptr      = void (*)(void* context);
+        using refvalue_svchostify_bind_heartbeat_ptr = void (*)(refvalue_svchostify_heartbeat_ptr, void* context);
+
+        constexpr std::uint32_t host_table_version = 2;
+
+        // The layout is a part of the ABI and is only ever extended at the end, the size tells the worker which
+        // members are available.
+        struct refvalue_svchostify_host_v2 {
+            std::uint32_t size;
+            std::uint32_t version;
+            void* context;
+            void (*log)(void* context, std::int32_t level, const char* message, std::size_t size);
+            std::int32_t (*stop_requested)(void* context);
+            std::int32_t (*wait_for_stop)(void* context, std::uint32_t timeout);
+            void (*heartbeat)(void* context);
+            void (*add_counter)(void* context, const char* name, std::int64_t delta);
+            void (*notify_ready)(void* context);
+            std::size_t (*get_listen_sockets)(void* context, std::uintptr_t* sockets, std::size_t capacity);
+        };
+
+        using refvalue_svchostify_init_v2_ptr = std::int32_t (*)(const refvalue_svchostify_host_v2* host);
+
+        // Timeouts are in milliseconds, and this value waits infinitely.
+        constexpr std::uint32_t infinite_timeout = std::numeric_limits<std::uint32_t>::max();
+
+        worker_context& get_context(void* context) noexcept {
+            return *static_cast<worker_context*>(context);
+        }
+
+        // The context is bound on every attach, the table itself stays at the same address for the lifetime of the
+        // worker, since the worker may keep the pointer.
+        std::unique_ptr<refvalue_svchostify_host_v2> make_host_table() {
+            return std::make_unique<refvalue_svchostify_host_v2>(refvalue_svchostify_host_v2{
+                .size    = sizeof(refvalue_svchostify_host_v2),
+                .version = host_table_version,
+                .context = nullptr,
+                .log =
+                    [](void* context, std::int32_t level, const char* message, std::size_t size) {
+                        // Logs directly instead of going through the redirected stdio.
+                        get_context(context).logger()->log(
+                            static_cast<spdlog::level::level_enum>(std::clamp<std::int32_t>(
+                                level, spdlog::level::trace, spdlog::level::critical)),
+                            std::string_view{message, size});
+                    },
+                .stop_requested = [](void* context) -> std::int32_t { return get_context(context).stop_requested(); },
+                .wait_for_stop =
+                    [](void* context, std::uint32_t timeout) -> std::int32_t {
+                        return get_context(context).wait_for_stop(timeout == infinite_timeout
+                                ? std::nullopt
+                                : std::optional{std::chrono::milliseconds{timeout}});
+                    },
+                .heartbeat   = [](void* context) { get_context(context).beat(); },
+                .add_counter = [](void* context, const char* name,
+                                   std::int64_t delta) { get_context(context).add_counter(name, delta); },
+                .notify_ready = [](void* context) { get_context(context).notify_ready(); },
+                .get_listen_sockets =
+                    [](void* context, std::uintptr_t* sockets, std::size_t capacity) {
+                        // Returns the total count, so that the worker may query it with a null buffer first.
+                        const auto result = get_context(context).listen_sockets();
+
+                        if (sockets != nullptr) {
+                            std::ranges::copy(result | std::views::take(capacity), sockets);
+                        }
+
+                        return result.size();
+                    },
+            });
+        }
 
         std::unique_ptr<const char*[]> make_argv(std::span<const std::string> args) {
             auto argv = std::make_unique_for_overwrite<const char*[]>(args.size());
@@ -54,15 +123,61 @@ namespace essence::win {
             return argv;
         }
 
+        // A DLL loaded under another name is mapped as a separate module with its own globals, the copy is removed
+        // once the module has been unloaded.
+        class module_copy {
+        public:
+            explicit module_copy(const std::filesystem::path& source) : path_{make_path(source)} {
+                std::filesystem::copy_file(source, path_);
+            }
+
+            module_copy(const module_copy&) = delete;
+
+            ~module_copy() {
+                std::error_code code;
+
+                std::filesystem::remove(path_, code);
+            }
+
+            module_copy& operator=(const module_copy&) = delete;
+
+            [[nodiscard]] const std::filesystem::path& path() const noexcept {
+                return path_;
+            }
+
+        private:
+            static std::filesystem::path make_path(const std::filesystem::path& source) {
+                static std::atomic_uint32_t counter;
+
+                return std::filesystem::temp_directory_path()
+                     / std::filesystem::path{std::format(L"svchostify-{}-{}-", GetCurrentProcessId(),
+                         counter.fetch_add(1, std::memory_order::relaxed))}
+                           .concat(source.filename().native());
+            }
+
+            std::filesystem::path path_;
+        };
+
         class pure_c_service_worker {
         public:
-            explicit pure_c_service_worker(service_config config) : config_{std::move(config)}, run_{}, on_stop_{} {
+            pure_c_service_worker(service_config config, bool private_copy)
+                : config_{std::move(config)}, run_{}, on_stop_{}, bind_heartbeat_{}, init_v2_{} {
                 if (config_.context.empty()) {
                     throw formatted_runtime_error{U8("The context must be a non-empty DLL path.")};
                 }
 
-                if (module_dll_.reset(LoadLibraryExW(
-                        to_native_string(config_.context).c_str(), nullptr, LOAD_LIBRARY_SEARCH_DEFAULT_DIRS));
+                if (private_copy) {
+                    try {
+                        copy_ = std::make_unique<module_copy>(to_u8string(config_.context));
+                    } catch (const std::exception&) {
+                        aggregate_error::throw_nested(formatted_runtime_error{
+                            U8("DLL Path"), config_.context, U8("Message"), U8("Failed to make a copy of the DLL.")});
+                    }
+                }
+
+                if (module_dll_.reset(LoadLibraryExW(copy_ ? copy_->path().c_str()
+                                                           : to_native_string(config_.context).c_str(),
+                        nullptr, LOAD_LIBRARY_SEARCH_DEFAULT_DIRS));
                     !module_dll_) {
                     throw formatted_runtime_error{
                         U8("DLL Path"), config_.context, U8("Message"), U8("Failed to load the DLL.")};
@@ -74,11 +189,23 @@ namespace essence::win {
                     throw formatted_runtime_error{U8("Failed to load the 'refvalue_svchostify_run' function.")};
                 }
 
+                // Optional.
+                init_v2_ = reinterpret_cast<refvalue_svchostify_init_v2_ptr>(
+                    GetProcAddress(module_dll_.get(), U8("refvalue_svchostify_init_v2")));
+
+                bind_heartbeat_ = reinterpret_cast<refvalue_svchostify_bind_heartbeat_ptr>(
+                    GetProcAddress(module_dll_.get(), U8("refvalue_svchostify_bind_heartbeat")));
+
+                // A worker of the v2 ABI may wait on the stop token of the host instead.
                 if (on_stop_ = reinterpret_cast<refvalue_svchostify_on_stop_ptr>(
                         GetProcAddress(module_dll_.get(), U8("refvalue_svchostify_on_stop")));
-                    on_stop_ == nullptr) {
+                    on_stop_ == nullptr && init_v2_ == nullptr) {
                     throw formatted_runtime_error{U8("Failed to load the 'refvalue_svchostify_on_stop' function.")};
                 }
+
+                if (init_v2_) {
+                    host_table_ = make_host_table();
+                }
             }
 
             pure_c_service_worker(pure_c_service_worker&&) noexcept = default;
@@ -89,10 +216,29 @@ namespace essence::win {
                 return config_;
             }
 
+            [[maybe_unused]] void attach(const std::shared_ptr<worker_context>& context) {
+                context_ = context;
+
+                if (bind_heartbeat_) {
+                    bind_heartbeat_([](void* inner) { get_context(inner).beat(); }, context_.get());
+                }
+
+                if (init_v2_) {
+                    host_table_->context = context_.get();
+
+                    if (const auto code = init_v2_(host_table_.get()); code != 0) {
+                        throw formatted_runtime_error{U8("DLL Path"), config_.context, U8("Code"), code, U8("Message"),
+                            U8("The 'refvalue_svchostify_init_v2' function failed.")};
+                    }
+                }
+            }
+
             [[maybe_unused]] static void on_start() noexcept {}
 
             void on_stop() const {
-                on_stop_();
+                if (on_stop_) {
+                    on_stop_();
+                }
             }
 
             [[maybe_unused]] void run() const {
@@ -108,13 +254,18 @@ namespace essence::win {
 
         private:
             service_config config_;
+            std::unique_ptr<module_copy> copy_;
             unique_module module_dll_;
             refvalue_svchostify_run_ptr run_;
             refvalue_svchostify_on_stop_ptr on_stop_;
+            refvalue_svchostify_bind_heartbeat_ptr bind_heartbeat_;
+            refvalue_svchostify_init_v2_ptr init_v2_;
+            std::shared_ptr<worker_context> context_;
+            std::unique_ptr<refvalue_svchostify_host_v2> host_table_;
         };
     } // namespace
 
-    abstract::service_worker make_pure_c_service_worker(service_config config) {
-        return abstract::service_worker{pure_c_service_worker{std::move(config)}};
+    abstract::service_worker make_pure_c_service_worker(service_config config, bool private_copy) {
+        return abstract::service_worker{pure_c_service_worker{std::move(config), private_copy}};
     }
 } // namespace essence::win
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2024 The RefValue Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+module;
+
+#include <essence/char8_t_remediation.hpp>
+#include <essence/compat.hpp>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NOGDI
+
+#include <Windows.h>
+
+module refvalue.svchostify;
+import :abstract.service_worker;
+import :service_config;
+import :service_worker;
+import :util;
+import essence.basic;
+import std;
+
+namespace essence::win {
+    namespace {
+        using unique_module = unique_handle<&FreeLibrary>;
+
+        struct py_object;
+
+        using py_ssize_t   = std::intptr_t;
+        using py_gil_state = int;
+
+        // The functions of the stable ABI, exported by python3.dll of any Python 3 runtime, so that neither the
+        // headers nor a particular version of Python is needed.
+        struct python_api {
+            void (*initialize)(int install_signal_handlers);
+            int (*is_initialized)();
+            void* (*save_thread)();
+            py_gil_state (*gil_ensure)();
+            void (*gil_release)(py_gil_state state);
+            py_object* (*import_module)(const char* name);
+            py_object* (*get_attribute)(py_object* object, const char* name);
+            py_object* (*call_object)(py_object* callable, py_object* arguments);
+            py_object* (*list_new)(py_ssize_t size);
+            int (*list_set_item)(py_object* list, py_ssize_t index, py_object* item);
+            int (*list_insert)(py_object* list, py_ssize_t index, py_object* item);
+            int (*sequence_contains)(py_object* sequence, py_object* item);
+            py_object* (*tuple_new)(py_ssize_t size);
+            int (*tuple_set_item)(py_object* tuple, py_ssize_t index, py_object* item);
+            py_object* (*unicode_from_string)(const char* data, py_ssize_t size);
+            py_object* (*unicode_as_utf8)(py_object* unicode);
+            int (*bytes_as_string)(py_object* bytes, char** data, py_ssize_t* size);
+            py_object* (*object_str)(py_object* object);
+            py_object* (*sys_get_object)(const char* name);
+            void (*error_fetch)(py_object** type, py_object** value, py_object** traceback);
+            void (*dec_ref)(py_object* object);
+        };
+
+        // Holds the GIL of the calling thread for the scope.
+        class gil_scope {
+        public:
+            explicit gil_scope(const python_api& api) : api_{api}, state_{api.gil_ensure()} {}
+
+            gil_scope(const gil_scope&) = delete;
+
+            ~gil_scope() {
+                api_.gil_release(state_);
+            }
+
+            gil_scope& operator=(const gil_scope&) = delete;
+
+        private:
+            const python_api& api_;
+            py_gil_state state_;
+        };
+
+        // Only to be released while holding the GIL.
+        struct py_ref_deleter {
+            const python_api* api{};
+
+            void operator()(py_object* object) const noexcept {
+                api->dec_ref(object);
+            }
+        };
+
+        using py_ref = std::unique_ptr<py_object, py_ref_deleter>;
+
+        class python_runtime {
+        public:
+            // The first worker loading Python decides its installation, as there is only one interpreter per process.
+            explicit python_runtime(const service_config& config) : api_{} {
+                const auto python = config.python.value_or(service_config::python_config{});
+                std::filesystem::path path{u8"python3.dll"};
+                DWORD flags{LOAD_LIBRARY_SEARCH_DEFAULT_DIRS};
+
+                // The directory of the DLL is only searched for a fully qualified path.
+                if (python.home) {
+                    const auto home = std::filesystem::absolute(to_u8string(*python.home));
+
+                    add_dll_directories(std::array{from_u8string(home.generic_u8string())});
+                    path = home / path;
+                    flags |= LOAD_LIBRARY_SEARCH_DLL_LOAD_DIR;
+                }
+
+                // The stable ABI DLL forwards to the versioned DLL next to it, which locates the standard library
+                // from its own directory.
+                if (module_.reset(LoadLibraryExW(path.generic_wstring().c_str(), nullptr, flags)); !module_) {
+                    throw formatted_runtime_error{U8("Python Runtime"), from_u8string(path.generic_u8string()),
+                        U8("Message"), U8("Failed to load Python."), U8("Internal"), get_last_error()};
+                }
+
+                load_function(U8("Py_InitializeEx"), api_.initialize);
+                load_function(U8("Py_IsInitialized"), api_.is_initialized);
+                load_function(U8("PyEval_SaveThread"), api_.save_thread);
+                load_function(U8("PyGILState_Ensure"), api_.gil_ensure);
+                load_function(U8("PyGILState_Release"), api_.gil_release);
+                load_function(U8("PyImport_ImportModule"), api_.import_module);
+                load_function(U8("PyObject_GetAttrString"), api_.get_attribute);
+                load_function(U8("PyObject_CallObject"), api_.call_object);
+                load_function(U8("PyList_New"), api_.list_new);
+                load_function(U8("PyList_SetItem"), api_.list_set_item);
+                load_function(U8("PyList_Insert"), api_.list_insert);
+                load_function(U8("PySequence_Contains"), api_.sequence_contains);
+                load_function(U8("PyTuple_New"), api_.tuple_new);
+                load_function(U8("PyTuple_SetItem"), api_.tuple_set_item);
+                load_function(U8("PyUnicode_FromStringAndSize"), api_.unicode_from_string);
+                load_function(U8("PyUnicode_AsUTF8String"), api_.unicode_as_utf8);
+                load_function(U8("PyBytes_AsStringAndSize"), api_.bytes_as_string);
+                load_function(U8("PyObject_Str"), api_.object_str);
+                load_function(U8("PySys_GetObject"), api_.sys_get_object);
+                load_function(U8("PyErr_Fetch"), api_.error_fetch);
+                load_function(U8("Py_DecRef"), api_.dec_ref);
+
+                // Leaves the signals to the host, and releases the GIL taken by the initialization, so that it is
+                // only held while the host calls into Python.
+                if (api_.is_initialized() == 0) {
+                    api_.initialize(0);
+                    api_.save_thread();
+                }
+            }
+
+            [[nodiscard]] const python_api& api() const noexcept {
+                return api_;
+            }
+
+        private:
+            template <typename T>
+            void load_function(const char* name, T& function) {
+                if (function = reinterpret_cast<T>(GetProcAddress(module_.get(), name)); function == nullptr) {
+                    throw formatted_runtime_error{U8("Function"), name, U8("Message"),
+                        U8("Failed to load the function from the Python runtime.")};
+                }
+            }
+
+            unique_module module_;
+            python_api api_;
+        };
+
+        const python_api& get_python_api(const service_config& config) {
+            [[maybe_unused]] ES_KEEP_ALIVE static const python_runtime runtime{config};
+
+            return runtime.api();
+        }
+
+        // Requires the GIL.
+        std::string describe_object(const python_api& api, py_object* object) {
+            const py_ref text{api.object_str(object), {&api}};
+
+            if (!text) {
+                return {};
+            }
+
+            const py_ref bytes{api.unicode_as_utf8(text.get()), {&api}};
+            char* data{};
+            py_ssize_t size{};
+
+            if (!bytes || api.bytes_as_string(bytes.get(), &data, &size) != 0) {
+                return {};
+            }
+
+            return std::string{data, static_cast<std::size_t>(size)};
+        }
+
+        // Requires the GIL.
+        [[noreturn]] void throw_python_error(const python_api& api) {
+            py_object* type{};
+            py_object* value{};
+            py_object* traceback{};
+
+            api.error_fetch(&type, &value, &traceback);
+
+            const py_ref type_ref{type, {&api}};
+            const py_ref value_ref{value, {&api}};
+            const py_ref traceback_ref{traceback, {&api}};
+
+            throw formatted_runtime_error{U8("Message"), U8("An exception was raised inside the Python code."),
+                U8("Python Exception"),
+                format(U8("{}: {}"), type ? describe_object(api, type) : std::string{},
+                    value ? describe_object(api, value) : std::string{})};
+        }
+
+        // Requires the GIL. Takes a new reference, throwing the pending Python exception if it is null.
+        py_ref checked(const python_api& api, py_object* result) {
+            if (result == nullptr) {
+                throw_python_error(api);
+            }
+
+            return py_ref{result, {&api}};
+        }
+
+        // Requires the GIL. Throws the pending Python exception if the status is -1.
+        int checked(const python_api& api, int result) {
+            if (result == -1) {
+                throw_python_error(api);
+            }
+
+            return result;
+        }
+
+        py_ref make_string(const python_api& api, std::string_view value) {
+            return checked(api, api.unicode_from_string(value.data(), static_cast<py_ssize_t>(value.size())));
+        }
+
+        class python_service_worker {
+        public:
+            explicit python_service_worker(service_config config)
+                : config_{std::move(config)}, api_{&get_python_api(config_)} {
+                if (config_.context.empty()) {
+                    throw formatted_runtime_error{U8("Module"), config_.context, U8("Message"),
+                        U8("The context must be the name of a Python module.")};
+                }
+
+                const auto python    = config_.python.value_or(service_config::python_config{});
+                const auto& defaults = service_config::defaults().python;
+                const gil_scope gil{*api_};
+
+                add_paths(python.paths.value_or(std::vector<std::string>{}));
+
+                const auto module = checked(*api_, api_->import_module(config_.context.c_str()));
+
+                run_ = share(checked(*api_,
+                    api_->get_attribute(module.get(), python.run_function.value_or(defaults.run_function).c_str())));
+                on_stop_ = share(checked(*api_,
+                    api_->get_attribute(module.get(), python.stop_function.value_or(defaults.stop_function).c_str())));
+            }
+
+            python_service_worker(python_service_worker&&) noexcept = default;
+
+            python_service_worker& operator=(python_service_worker&&) noexcept = default;
+
+            [[nodiscard]] const service_config& config() const noexcept {
+                return config_;
+            }
+
+            [[maybe_unused]] static void on_start() noexcept {}
+
+            // Holding the GIL serializes the call with the running Python code, which switches between its threads.
+            [[maybe_unused]] void on_stop() const {
+                const gil_scope gil{*api_};
+
+                checked(*api_, api_->call_object(on_stop_.get(), nullptr));
+            }
+
+            [[maybe_unused]] void run() const {
+                const gil_scope gil{*api_};
+                const auto arguments = config_.arguments.value_or(std::vector<std::string>{});
+                auto list            = checked(*api_, api_->list_new(static_cast<py_ssize_t>(arguments.size())));
+
+                for (py_ssize_t i = 0; auto&& item : arguments) {
+                    checked(*api_, api_->list_set_item(list.get(), i++, make_string(*api_, item).release()));
+                }
+
+                const auto tuple = checked(*api_, api_->tuple_new(1));
+
+                checked(*api_, api_->tuple_set_item(tuple.get(), 0, list.release()));
+                checked(*api_, api_->call_object(run_.get(), tuple.get()));
+            }
+
+        private:
+            // Requires the GIL. The interpreter is shared, so a path already added by another service is skipped.
+            void add_paths(const std::vector<std::string>& paths) const {
+                const auto sys_path = api_->sys_get_object(U8("path"));
+
+                if (sys_path == nullptr) {
+                    throw formatted_runtime_error{U8("Failed to get 'sys.path' of the Python runtime.")};
+                }
+
+                for (auto&& item : paths | std::views::reverse) {
+                    const auto path = make_string(*api_, item);
+
+                    if (checked(*api_, api_->sequence_contains(sys_path, path.get())) == 0) {
+                        checked(*api_, api_->list_insert(sys_path, 0, path.get()));
+                    }
+                }
+            }
+
+            // Released with the GIL taken, as the worker may be destroyed by any thread.
+            std::shared_ptr<py_object> share(py_ref object) const {
+                return {object.release(), [api = api_](py_object* inner) {
+                            const gil_scope gil{*api};
+
+                            api->dec_ref(inner);
+                        }};
+            }
+
+            service_config config_;
+            const python_api* api_;
+            std::shared_ptr<py_object> run_;
+            std::shared_ptr<py_object> on_stop_;
+        };
+    } // namespace
+
+    abstract::service_worker make_python_service_worker(service_config config) {
+        return abstract::service_worker{python_service_worker{std::move(config)}};
+    }
+} // namespace essence::win